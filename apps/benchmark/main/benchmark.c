@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Linux target benchmark of the iperf engine.
+ *
+ * Sweeps transport, protocol, buffer length, stream count and pacing over loopback. Every case prints one line
+ * "BENCHMARK_RESULT <json>", the sweep ends with "BENCHMARK_DONE". The results are compared against a baseline recorded
+ * on the CI host by pytest_benchmark.py.
+ * The memory transport measures the engine alone (traffic loops, accounting, pacing and reporting), the socket
+ * transport adds the lwIP loopback path.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+
+#include "iperf.h"
+
+static const char *TAG = "benchmark";
+
+#define BENCHMARK_TIME_SEC          3
+#define BENCHMARK_INTERVAL_SEC      1
+#define BENCHMARK_BASE_PORT         5001
+#define BENCHMARK_MAX_STREAMS       4
+#define BENCHMARK_PACED_BW_LIM      (50 * 1000 * 1000)  // bits/s, split between the streams
+#define BENCHMARK_CLOSE_TMO_MS      ((BENCHMARK_TIME_SEC + 10) * 1000)
+
+static const iperf_transport_type_t s_transports[] = { IPERF_TRANSPORT_MEMORY, IPERF_TRANSPORT_SOCKET };
+static const uint32_t s_protocols[] = { IPERF_FLAG_TCP, IPERF_FLAG_UDP };
+static const uint16_t s_buffer_lens[] = { 64, 512, 1400 };
+static const uint8_t s_streams[] = { 1, BENCHMARK_MAX_STREAMS };
+static const int32_t s_bw_lims[] = { IPERF_DEFAULT_NO_BW_LIMIT, BENCHMARK_PACED_BW_LIM };
+
+typedef struct {
+    EventGroupHandle_t event_group;
+    iperf_traffic_report_t reports[2 * BENCHMARK_MAX_STREAMS + 1];  /* indexed by instance id */
+} benchmark_data_t;
+
+/* time spent in the report output path, the report task is the only writer */
+static uint64_t s_report_us;
+static uint32_t s_report_cnt;
+
+/* override weak func, measures the cost of formatting and printing the reports */
+void iperf_report_output(const iperf_report_t* report)
+{
+    int64_t start = esp_timer_get_time();
+    iperf_default_report_output(report);
+    s_report_us += esp_timer_get_time() - start;
+    s_report_cnt++;
+}
+
+static void benchmark_state_cb(iperf_id_t id, iperf_state_data_t* data, void *priv)
+{
+    benchmark_data_t *bench = (benchmark_data_t *)priv;
+
+    if (data->state == IPERF_CLOSED) {
+        iperf_get_traffic_report(id, &bench->reports[id]);
+        xEventGroupSetBits(bench->event_group, BIT(id));
+    }
+}
+
+static const char *benchmark_transport_name(iperf_transport_type_t transport)
+{
+    switch (transport) {
+    case IPERF_TRANSPORT_MEMORY:
+        return "memory";
+    case IPERF_TRANSPORT_NETCONN:
+        return "netconn";
+    default:
+        return "socket";
+    }
+}
+
+static double benchmark_mbps(const iperf_traffic_report_t *traffic)
+{
+    if (traffic->end_sec == 0) {
+        return 0;
+    }
+    return traffic->total_transfer_bytes * 8.0 / traffic->end_sec / 1000.0 / 1000.0;
+}
+
+static esp_err_t benchmark_run_case(benchmark_data_t *bench, iperf_transport_type_t transport, uint32_t protocol,
+                                    uint16_t buffer_len, uint8_t streams, int32_t bw_lim)
+{
+    esp_ip_addr_t addr_any = ESP_IP4ADDR_INIT(0, 0, 0, 0);
+    esp_ip_addr_t addr_loopback = ESP_IP4ADDR_INIT(127, 0, 0, 1);
+    esp_err_t ret = ESP_OK;
+    EventBits_t all_bits = 0;
+
+    memset(bench->reports, 0, sizeof(bench->reports));
+    s_report_us = 0;
+    s_report_cnt = 0;
+
+    // one server per stream, a TCP server accepts a single connection
+    for (uint8_t i = 0; i < streams; i++) {
+        iperf_cfg_t server_cfg = IPERF_DEFAULT_CONFIG_SERVER(protocol, addr_any);
+        server_cfg.state_handler = benchmark_state_cb;
+        server_cfg.state_handler_priv = bench;
+        server_cfg.interval = BENCHMARK_INTERVAL_SEC;
+        server_cfg.time = BENCHMARK_TIME_SEC;
+        server_cfg.sport = BENCHMARK_BASE_PORT + i;
+        server_cfg.len_send_buf = buffer_len;
+        server_cfg.transport = transport;
+        server_cfg.instance_id = 1 + i;
+        ESP_GOTO_ON_FALSE(iperf_start_instance(&server_cfg) == server_cfg.instance_id, ESP_FAIL, err, TAG, "failed to start server");
+        all_bits |= BIT(server_cfg.instance_id);
+    }
+    vTaskDelay(pdMS_TO_TICKS(100)); // invoke context switch so servers are listening before clients connect
+    for (uint8_t i = 0; i < streams; i++) {
+        iperf_cfg_t client_cfg = IPERF_DEFAULT_CONFIG_CLIENT(protocol, addr_loopback);
+        client_cfg.state_handler = benchmark_state_cb;
+        client_cfg.state_handler_priv = bench;
+        client_cfg.interval = BENCHMARK_INTERVAL_SEC;
+        client_cfg.time = BENCHMARK_TIME_SEC;
+        client_cfg.dport = BENCHMARK_BASE_PORT + i;
+        client_cfg.len_send_buf = buffer_len;
+        client_cfg.bw_lim = bw_lim > 0 ? bw_lim / streams : bw_lim;
+        client_cfg.transport = transport;
+        client_cfg.instance_id = 1 + streams + i;
+        ESP_GOTO_ON_FALSE(iperf_start_instance(&client_cfg) == client_cfg.instance_id, ESP_FAIL, err, TAG, "failed to start client");
+        all_bits |= BIT(client_cfg.instance_id);
+    }
+    EventBits_t bits = xEventGroupWaitBits(bench->event_group, all_bits, pdTRUE, pdTRUE, pdMS_TO_TICKS(BENCHMARK_CLOSE_TMO_MS));
+    ESP_GOTO_ON_FALSE((bits & all_bits) == all_bits, ESP_ERR_TIMEOUT, err, TAG, "not all instances finished in time");
+    vTaskDelay(pdMS_TO_TICKS(100)); // invoke context switch so instances are removed before the next case reuses their ids
+
+    double rx_mbps = 0;
+    double tx_mbps = 0;
+    double tx_pps = 0;
+    uint64_t bytes = 0;
+    uint64_t cpu_time_us = 0;
+    uint32_t lost = 0;
+    for (uint8_t i = 0; i < streams; i++) {
+        const iperf_traffic_report_t *server = &bench->reports[1 + i];
+        const iperf_traffic_report_t *client = &bench->reports[1 + streams + i];
+        rx_mbps += benchmark_mbps(server);
+        tx_mbps += benchmark_mbps(client);
+        if (client->end_sec != 0) {
+            tx_pps += (double)client->transport_stats.send_calls / client->end_sec;
+        }
+        bytes += server->total_transfer_bytes;
+        cpu_time_us += server->cpu_time_us + client->cpu_time_us;
+        lost += server->total_lost_datagrams;
+    }
+    double cpu_sec_per_gbyte = bytes ? cpu_time_us / 1000.0 / 1000.0 / (bytes / 1024.0 / 1024.0 / 1024.0) : 0;
+    double report_us = s_report_cnt ? (double)s_report_us / s_report_cnt : 0;
+
+    printf("BENCHMARK_RESULT {\"name\": \"%s_%s_len%" PRIu16 "_p%" PRIu8 "_%s\", "
+           "\"transport\": \"%s\", \"protocol\": \"%s\", \"len\": %" PRIu16 ", \"streams\": %" PRIu8 ", \"bw_lim\": %" PRIi32 ", "
+           "\"rx_mbps\": %.2f, \"tx_mbps\": %.2f, \"tx_pps\": %.0f, \"lost\": %" PRIu32 ", "
+           "\"cpu_sec_per_gbyte\": %.3f, \"report_us\": %.1f}\n",
+           benchmark_transport_name(transport), protocol == IPERF_FLAG_UDP ? "udp" : "tcp", buffer_len, streams,
+           bw_lim > 0 ? "paced" : "unpaced",
+           benchmark_transport_name(transport), protocol == IPERF_FLAG_UDP ? "udp" : "tcp", buffer_len, streams, bw_lim,
+           rx_mbps, tx_mbps, tx_pps, lost,
+           cpu_sec_per_gbyte, report_us);
+    return ESP_OK;
+err:
+    // release the instance ids for the next case
+    iperf_stop_instance(IPERF_ALL_INSTANCES_ID);
+    if (all_bits) {
+        xEventGroupWaitBits(bench->event_group, all_bits, pdTRUE, pdTRUE, pdMS_TO_TICKS(BENCHMARK_CLOSE_TMO_MS));
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+    return ret;
+}
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(esp_netif_init());
+
+    benchmark_data_t bench = {
+        .event_group = xEventGroupCreate(),
+    };
+    if (bench.event_group == NULL) {
+        ESP_LOGE(TAG, "failed to create event group");
+        return;
+    }
+    vTaskPrioritySet(NULL, 10); // set higher than iperf default to not affect the benchmark flow
+
+    uint32_t failed = 0;
+    for (size_t t = 0; t < sizeof(s_transports) / sizeof(s_transports[0]); t++) {
+        for (size_t p = 0; p < sizeof(s_protocols) / sizeof(s_protocols[0]); p++) {
+            for (size_t l = 0; l < sizeof(s_buffer_lens) / sizeof(s_buffer_lens[0]); l++) {
+                for (size_t s = 0; s < sizeof(s_streams) / sizeof(s_streams[0]); s++) {
+                    for (size_t b = 0; b < sizeof(s_bw_lims) / sizeof(s_bw_lims[0]); b++) {
+                        if (benchmark_run_case(&bench, s_transports[t], s_protocols[p], s_buffer_lens[l], s_streams[s], s_bw_lims[b]) != ESP_OK) {
+                            failed++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    printf("BENCHMARK_DONE failed=%" PRIu32 "\n", failed);
+    vEventGroupDelete(bench.event_group);
+}
@@ -0,0 +1,86 @@
+# SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+import json
+import os
+
+from typing import Any
+from typing import Dict
+from typing import List
+
+import pytest
+
+from pytest_embedded import Dut
+
+BASELINE_FILE = os.path.join(os.path.dirname(__file__), 'benchmark_baseline.json')
+
+# allowed relative regression against the baseline, a baseline case may set its own "tolerance"
+BENCHMARK_TOLERANCE = float(os.getenv('BENCHMARK_TOLERANCE', '0.2'))
+# store the results as the new baseline instead of comparing
+BENCHMARK_UPDATE_BASELINE = os.getenv('BENCHMARK_UPDATE_BASELINE', '0') == '1'
+
+# metric: True if higher is better
+BENCHMARK_METRICS: Dict[str, bool] = {
+    'rx_mbps': True,
+    'tx_pps': True,
+    'cpu_sec_per_gbyte': False,
+    'report_us': False,
+}
+
+
+def _compare(result: Dict[str, Any], baseline: Dict[str, Any]) -> List[str]:
+    regressions = []
+    tolerance = baseline.get('tolerance', BENCHMARK_TOLERANCE)
+    for metric, higher_is_better in BENCHMARK_METRICS.items():
+        if metric not in baseline:
+            regressions.append(f'{result["name"]}: no {metric} baseline, record it with BENCHMARK_UPDATE_BASELINE=1')
+            continue
+        expected = baseline[metric]
+        actual = result[metric]
+        if higher_is_better and actual < expected * (1 - tolerance):
+            regressions.append(f'{result["name"]}: {metric} {actual} < {expected} (baseline)')
+        elif not higher_is_better and actual > expected * (1 + tolerance):
+            regressions.append(f'{result["name"]}: {metric} {actual} > {expected} (baseline)')
+    return regressions
+
+
+@pytest.mark.target('linux')
+@pytest.mark.env('host')
+@pytest.mark.timeout(15 * 60)
+@pytest.mark.parametrize('embedded_services', ['idf'], indirect=True)
+def test_iperf_benchmark(dut: Dut, session_tempdir: str) -> None:
+    results: Dict[str, Dict[str, Any]] = {}
+    while True:
+        match = dut.expect(r'BENCHMARK_(RESULT (\{.*\})|DONE failed=(\d+))', timeout=60)
+        if match[3] is not None:
+            failed = int(match[3])
+            break
+        result = json.loads(match[2])
+        results[result['name']] = result
+
+    with open(os.path.join(session_tempdir, 'benchmark_results.json'), 'w') as f:
+        json.dump(results, f, indent=2)
+    assert failed == 0, f'{failed} benchmark cases failed to run'
+
+    if BENCHMARK_UPDATE_BASELINE:
+        for result in results.values():
+            result['tolerance'] = BENCHMARK_TOLERANCE
+        with open(BASELINE_FILE, 'w') as f:
+            json.dump({'cases': results}, f, indent=2)
+            f.write('\n')
+        return
+
+    if not os.path.exists(BASELINE_FILE):
+        # measured numbers of the CI host only, the results above are kept to record them
+        pytest.skip(f'no baseline in {BASELINE_FILE}, record it on the CI host with BENCHMARK_UPDATE_BASELINE=1')
+    with open(BASELINE_FILE) as f:
+        baseline = json.load(f)['cases']
+    regressions = []
+    for name, result in results.items():
+        if name not in baseline:
+            regressions.append(f'{name}: no baseline, record it with BENCHMARK_UPDATE_BASELINE=1')
+            continue
+        regressions += _compare(result, baseline[name])
+    for name in baseline:
+        if name not in results:
+            regressions.append(f'{name}: no result')
+    assert not regressions, '\n'.join(regressions)
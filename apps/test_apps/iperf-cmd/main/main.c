@@ -1,9 +1,10 @@
 /*
- * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2024-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
 
@@ -12,10 +13,12 @@
 #error "Both LWIP_IPV4 and LWIP_IPV6 should be defined!"
 #endif
 
+#include "esp_idf_version.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_console.h"
 #include "esp_netif.h"
+#include "esp_vfs_fat.h"
 
 #include "iperf_cmd.h"
 
@@ -28,6 +31,45 @@ void my_report_func(void)
     }
 }
 
+/* trace of iperf --trace: 100 datagrams, 10 ms apart */
+extern const uint8_t trace_bin_start[] asm("_binary_trace_bin_start");
+extern const uint8_t trace_bin_end[] asm("_binary_trace_bin_end");
+
+static void write_test_file(const char *path, const uint8_t *start, const uint8_t *end)
+{
+    size_t len = end - start;
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGE("test", "cannot create %s - errno %d", path, errno);
+        return;
+    }
+    if (fwrite(start, 1, len, f) != len) {
+        ESP_LOGE("test", "cannot write %s - errno %d", path, errno);
+    }
+    fclose(f);
+}
+
+/* payload of iperf -F: <len> bytes counting up */
+static void write_payload_file(const char *path, size_t len)
+{
+    uint8_t block[256];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = i;
+    }
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGE("test", "cannot create %s - errno %d", path, errno);
+        return;
+    }
+    for (size_t written = 0; written < len; written += sizeof(block)) {
+        if (fwrite(block, 1, sizeof(block), f) != sizeof(block)) {
+            ESP_LOGE("test", "cannot write %s - errno %d", path, errno);
+            break;
+        }
+    }
+    fclose(f);
+}
+
 /* override weak func */
 void iperf_report_output(const iperf_report_t* report)
 {
@@ -40,6 +82,21 @@ void app_main(void)
 
     ESP_ERROR_CHECK(esp_netif_init());
 
+    /* files of the file tests (iperf -F, --write, --trace) */
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    esp_vfs_fat_mount_config_t mount_config = {
+        .max_files = 4,
+        .format_if_mount_failed = true,
+        .allocation_unit_size = CONFIG_WL_SECTOR_SIZE,
+    };
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+    ESP_ERROR_CHECK(esp_vfs_fat_spiflash_mount_rw_wl("/data", "storage", &mount_config, &wl_handle));
+#else
+    ESP_ERROR_CHECK(esp_vfs_fat_spiflash_mount("/data", "storage", &mount_config, &wl_handle));
+#endif
+    write_test_file("/data/trace.bin", trace_bin_start, trace_bin_end);
+    write_payload_file("/data/payload.bin", 64 * 1024);
+
     esp_console_repl_t *repl = NULL;
     esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
     esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2025-2026 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Apache-2.0
 import os
 import time
@@ -93,3 +93,262 @@ def test_iperf_cmd(dut: Dut) -> None:
     assert abs(float(match2[3]) - float(match1[3])) < 1
     dut.expect(r'\[\s*[12]\]\s+0.0- [89].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec')
     dut.expect(r'\[\s*[12]\]\s+0.0- [89].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec')
+
+    # netconn transport over loopback, tcp and paced udp
+    time.sleep(1)
+    dut.write('iperf -s -i 1 -t 3 --transport=netconn --id=1')
+    dut.expect(r'\[TCP Server\] Netconn created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -i 1 -t 3 --transport=netconn --id=2')
+    ids = set()
+    for _ in range(2):
+        match = dut.expect(r'\[\s*([12])\]\s+0.0- [23].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+        assert float(match[2]) > 0
+        ids.add(int(match[1]))
+    assert ids == {1, 2}
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 4 --transport=netconn --id=1')
+    dut.expect(r'\[UDP Server\] Netconn created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 2m -i 1 -t 3 --transport=netconn --id=2')
+    match = dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert 1.5 < float(match[2]) < 2.5
+    match = dut.expect(r'\[\s*1\]\s+0.0- [34].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert float(match[1]) > 0
+
+    # tcp request/response
+    time.sleep(1)
+    dut.write('iperf -s --rr -i 1 -t 5 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 --rr --response=64 -i 1 -t 5 --id=2')
+    dut.expect('Interval', timeout=1)
+    match = dut.expect(r'\[\s*[12]\]\s+1.0- 2.0 sec\s+.+\s+(\d+) trans\s+([\d\.]+) trans/sec')
+    assert int(match[1]) > 0
+    dut.expect(r'\[\s*2\] RTT min/avg/p50/p90/p99/max (\d+)/(\d+)/(\d+)/(\d+)/(\d+)/(\d+) us\s+0 timeouts', timeout=10)
+
+    # tcp connection rate
+    time.sleep(1)
+    dut.write('iperf -s --crr -i 1 -t 5 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 --crr -i 1 -t 5 --id=2')
+    dut.expect('Interval', timeout=1)
+    match = dut.expect(r'\[\s*[12]\]\s+1.0- 2.0 sec\s+.+\s+(\d+) conn\s+([\d\.]+) conn/sec\s+(\d+) failed')
+    assert int(match[1]) > 0
+    dut.expect(r'\[\s*2\] Connect min/avg/p50/p90/p99/max (\d+)/(\d+)/(\d+)/(\d+)/(\d+)/(\d+) us', timeout=10)
+
+    # tcp daemon server, consecutive clients with a summary each
+    time.sleep(1)
+    dut.write('iperf -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    for client_id in (2, 3):
+        dut.write(f'iperf -c 127.0.0.1 -t 3 --id={client_id}')
+        dut.expect(r'\[\s*1\]\s+0.0- [23].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+        time.sleep(1)
+    dut.write('iperf --abort --id=1')
+    dut.expect('DONE.IPERF_STOP,OK', timeout=1)
+
+    # udp daemon server, the final datagram of each client ends its session
+    time.sleep(1)
+    dut.write('iperf -u -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    for client_id in (2, 3):
+        dut.write(f'iperf -u -c 127.0.0.1 -b 2m -t 3 --id={client_id}')
+        dut.expect(r'\[\s*1\]\s+0.0- [23].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+        time.sleep(1)
+    dut.write('iperf --abort --id=1')
+    dut.expect('DONE.IPERF_STOP,OK', timeout=1)
+
+    # warm tcp client, restarted on its kept connection
+    time.sleep(1)
+    dut.write('iperf -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -t 2 --keep-conn --id=2')
+    dut.expect(r'\[\s*2\] Start latency (\d+) us', timeout=10)
+    time.sleep(1)
+    dut.write('iperf -c 127.0.0.1 -t 2 --keep-conn --restart --id=2')
+    dut.expect(r'\[\s*2\]\s+0.0- 2.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    dut.expect(r'\[\s*2\] Start latency (\d+) us', timeout=10)
+    dut.write('iperf --abort')
+    dut.expect('DONE.IPERF_STOP,OK', timeout=1)
+
+    # paced udp client, bandwidth changed while running
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 6 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 10m -i 1 -t 6 --id=2')
+    dut.expect(r'\[\s*2\]\s+0.0- 1.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=5)
+    dut.write('iperf --id=2 --set-bw=5m')
+    dut.expect('DONE.IPERF_SET_BW,OK', timeout=1)
+    match = dut.expect(r'\[\s*2\]\s+3.0- 4.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=5)
+    assert float(match[2]) < 6
+
+    # udp client bandwidth ramp, one summary per step
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 6 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 6 --ramp=2m,2m,2,6m --id=2')
+    for step, bw_lim in ((1, 2), (2, 4), (3, 6)):
+        match = dut.expect(rf'\[\s*2\] Step {step} at {bw_lim}.00 Mbits/sec:\s+\[\s*2\]\s+\d+.0-\s*\d+.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec',
+                           timeout=5)
+        assert float(match[2]) < bw_lim * 1.2
+
+    # warm udp client ramp, restarted with its last configuration from the start bandwidth
+    time.sleep(1)
+    dut.write('iperf -u -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 4 --ramp=2m,2m,2 --warm --id=2')
+    for run in range(2):
+        if run > 0:
+            time.sleep(1)
+            dut.write('iperf --restart --id=2')
+        for step, bw_lim in ((1, 2), (2, 4)):
+            match = dut.expect(rf'\[\s*2\] Step {step} at {bw_lim}.00 Mbits/sec:\s+\[\s*2\]\s+\d+.0-\s*\d+.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec',
+                               timeout=5)
+            assert float(match[2]) < bw_lim * 1.2
+    dut.write('iperf --abort')
+    dut.expect('DONE.IPERF_STOP,OK', timeout=1)
+
+    # tcp payload verification
+    time.sleep(1)
+    dut.write('iperf -s --verify -i 1 -t 4 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 --verify -i 1 -t 4 --id=2')
+    dut.expect(r'\[\s*1\]\s+1.0- 2.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec\s+0 corrupt bytes in 0 segments', timeout=5)
+    dut.expect(r'\[\s*1\]\s+0.0- [34].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec\s+0 corrupt bytes in 0 segments', timeout=10)
+
+    # udp server writing the received data to a file on the FAT partition
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 3 --write=/data/rx.bin --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 400k -i 1 -t 3 --id=2')
+    match = dut.expect(r'\[\s*1\] File ([\d\.]+) MBytes written\s+waited ([\d\.]+) ms for writes, ([\d\.]+) ms in recv: (write|network) bound',
+                       timeout=10)
+    assert float(match[1]) > 0
+
+    # tcp and paced udp clients sending a payload file, read ahead from the fat partition
+    time.sleep(1)
+    dut.write('iperf -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -i 1 -t 3 -F /data/payload.bin --id=2')
+    match = dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert float(match[1]) > 0
+    match = dut.expect(r'\[\s*2\] File ([\d\.]+) MBytes read\s+waited ([\d\.]+) ms for file, ([\d\.]+) ms in send: (file|network) bound', timeout=1)
+    assert float(match[1]) > 0
+    dut.write('iperf --abort --id=1')
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 2m -i 1 -t 3 -F /data/payload.bin --id=2')
+    match = dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert 1.5 < float(match[2]) < 2.5
+    match = dut.expect(r'\[\s*2\] File ([\d\.]+) MBytes read\s+waited ([\d\.]+) ms for file, ([\d\.]+) ms in send: (file|network) bound', timeout=1)
+    assert float(match[1]) > 0
+
+    # isochronous udp frames, reassembled by the server
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 4 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 4 --isochronous=30:2m,500k --id=2')
+    match = dut.expect(r'\[\s*1\] Frames (\d+) complete\s+(\d+) incomplete\s+(\d+) late', timeout=10)
+    assert int(match[1]) > 60
+    dut.expect(r'\[\s*1\] Frame latency min/avg/p50/p90/p99/max (\d+)/(\d+)/(\d+)/(\d+)/(\d+)/(\d+) us', timeout=1)
+
+    # udp traffic model, poisson arrivals of an imix averaging the bandwidth limit
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 4 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 5m -i 1 -t 4 --model=poisson --imix=64:7,576:4,1470:1 --seed=42 --id=2')
+    dut.expect('traffic model seed 42', timeout=1)
+    match = dut.expect(r'\[\s*1\]\s+0.0- [34].0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert 2.5 < float(match[2]) < 7.5
+
+    # udp client replaying the trace fixture (100 datagrams in 1 sec) once, then looped
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 4 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 4 --trace=/data/trace.bin --id=2')
+    dut.expect('trace replayed, test ends', timeout=5)
+    dut.expect(r'\[\s*2\] Replayed 100 datagrams\s+0 loops', timeout=5)
+    match = dut.expect(r'\[\s*2\] Replay timing error min/avg/p50/p90/p99/max (\d+)/(\d+)/(\d+)/(\d+)/(\d+)/(\d+) us', timeout=1)
+    assert int(match[2]) < 10000
+    dut.write('iperf --abort --id=1')
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 3 --trace=/data/trace.bin --trace-loop --id=2')
+    match = dut.expect(r'\[\s*2\] Replayed (\d+) datagrams\s+(\d+) loops', timeout=10)
+    assert int(match[2]) >= 1
+    assert int(match[1]) >= 100 * int(match[2])
+    dut.expect(r'\[\s*2\] Replay timing error min/avg/p50/p90/p99/max (\d+)/(\d+)/(\d+)/(\d+)/(\d+)/(\d+) us', timeout=1)
+
+    # tcp client under a stepped cpu load, one summary per load level
+    time.sleep(1)
+    dut.write('iperf -s -i 1 -t 6 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -i 1 -t 6 --load=20,30,2 --id=2')
+    for step, duty in ((1, 20), (2, 50), (3, 80)):
+        dut.expect(rf'\[\s*2\] Load step {step} at {duty}% CPU:\s+\[\s*2\]\s+\d+.0-\s*\d+.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec',
+                   timeout=5)
+    dut.expect(r'\[\s*2\] Load \d+% CPU\s+busy ([\d\.]+) sec', timeout=5)
+
+    # unlimited udp client backing off when the stack is out of buffers
+    time.sleep(1)
+    dut.write('iperf -u -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -i 1 -t 3 --backoff=delay:8 --id=2')
+    match = dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec\s+(\d+) failed sends\s+offered ([\d\.]+) Mbits/sec',
+                       timeout=10)
+    failed_sends = int(match[3])
+    assert failed_sends > 0
+    assert float(match[4]) >= float(match[2])
+    match = dut.expect(r'\[\s*2\] Backoff ([\d\.]+) ms after (\d+) failed sends', timeout=1)
+    assert float(match[1]) > 0
+    assert int(match[2]) == failed_sends
+
+    # socket buffer size autotune of a tcp client without nagle, against a daemon server
+    time.sleep(1)
+    dut.write('iperf -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -N -l 8192 -t 1 --autotune')
+    dut.expect(r'Window\tApplied\tLength\tThroughput', timeout=5)
+    match = dut.expect(r'best: (-w \d+ )?-l 8192, ([\d\.]+) Mbits/sec', timeout=30)
+    assert float(match[2]) > 0
+    dut.expect('DONE.IPERF_AUTOTUNE,OK', timeout=1)
+    dut.write('iperf --abort --id=1')
+
+    # tcp client writing 256 KB per call, gathered from 16 iovecs of a 16 KB buffer
+    time.sleep(1)
+    dut.write('iperf -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -i 1 -t 3 -l 262144 --iov=16 --stats --id=2')
+    dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    match = dut.expect(r'\[\s*2\] (\d+) calls\s+(\d+) Bytes/call', timeout=1)
+    # writes above 64 KB reach the socket layer
+    assert int(match[2]) > 65535
+    # paced: each Tx period sends the whole -l write, not one iovec
+    time.sleep(1)
+    dut.write('iperf -s -i 1 -t 3 --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -c 127.0.0.1 -i 1 -t 3 -l 65536 --iov=16 -b 8m --id=2')
+    match = dut.expect(r'\[\s*2\]\s+0.0- 3.0 sec\s+([\d\.]+) MBytes\s+([\d\.]+) Mbits/sec', timeout=10)
+    assert 4 < float(match[2]) < 8 * 1.2
+
+    # stream count sweep of paced udp clients against a daemon server, one table row per step
+    time.sleep(1)
+    dut.write('iperf -u -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -b 2m -t 2 --sweep=2')
+    for streams in (1, 2):
+        match = dut.expect(rf'\s+{streams}\t([\d\.]+) Mbits/sec\t([\d\.]+) Mbits/sec', timeout=30)
+        assert float(match[1]) > 0
+    dut.expect('DONE.IPERF_SWEEP,OK', timeout=5)
+    dut.write('iperf --abort --id=1')
+
+    # udp throughput search of one datagram length, the server reports the loss of every trial
+    time.sleep(1)
+    dut.write('iperf -u -s -D --id=1')
+    dut.expect('Socket created', timeout=1)
+    dut.write('iperf -u -c 127.0.0.1 -l 1470 -b 20m -t 1 --search=1')
+    match = dut.expect(r'\s+1470\t([\d\.]+) Mbits/sec\t([\d\.]+)%\t(\d+)', timeout=60)
+    assert float(match[1]) > 0
+    assert float(match[2]) <= 1
+    dut.expect('DONE.IPERF_SEARCH,OK', timeout=1)
+    dut.write('iperf --abort --id=1')
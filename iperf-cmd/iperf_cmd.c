@@ -6,8 +6,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
+#include <sys/param.h>
 #include <sys/socket.h>
 // #include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_console.h"
 #include "argtable3/argtable3.h"
@@ -26,6 +30,16 @@
 #define IPERF_CMD_INSTANCE_USE_IPV4    1
 #define IPERF_CMD_INSTANCE_USE_IPV6    2
 
+#define IPERF_CMD_SWEEP_TASK_NAME           "iperf_sweep"
+#define IPERF_CMD_SWEEP_TASK_STACK          4096
+#define IPERF_CMD_SWEEP_CLOSE_MARGIN_SEC    10   /* instances need some time to close after the test time elapsed */
+#define IPERF_CMD_SWEEP_STEP_DELAY_MS       1000 /* let the peer release the previous connections */
+#define IPERF_CMD_SWEEP_KNEE_GAIN           1.1  /* aggregate bandwidth gain below which the step is the scaling knee */
+#define IPERF_CMD_SEARCH_TRIAL_SEC          2    /* default trial time of the throughput search */
+#define IPERF_CMD_SEARCH_MAX_TRIALS         12
+#define IPERF_CMD_SEARCH_RESOLUTION         0.02 /* search ends when the rate interval is below this fraction of its top */
+#define IPERF_CMD_AUTOTUNE_TRIAL_SEC        2    /* default probe time of the socket tuning */
+
 typedef struct {
     struct arg_lit *help;
     struct arg_str *ip;
@@ -42,16 +56,87 @@ typedef struct {
     struct arg_int *time;
     struct arg_str *bw_limit;
     struct arg_str *format;
+    struct arg_lit *stats;
     struct arg_int *tos;
     struct arg_int *id;
     struct arg_lit *abort;
     struct arg_int *parallel;
+    struct arg_str *transport;
+    struct arg_int *sweep;
+    struct arg_dbl *search;
+    struct arg_lit *rr;
+    struct arg_int *response;
+    struct arg_lit *crr;
+    struct arg_lit *daemon;
+    struct arg_lit *warm;
+    struct arg_lit *keep_conn;
+    struct arg_lit *restart;
+    struct arg_str *set_bw;
+    struct arg_str *ramp;
+    struct arg_lit *verify;
+    struct arg_str *file;
+    struct arg_str *write;
+    struct arg_str *isochronous;
+    struct arg_str *model;
+    struct arg_str *imix;
+    struct arg_int *seed;
+    struct arg_str *trace;
+    struct arg_lit *trace_loop;
+    struct arg_str *load;
+    struct arg_int *load_core;
+    struct arg_int *load_priority;
+    struct arg_int *load_mem;
+    struct arg_str *backoff;
+    struct arg_int *window;
+    struct arg_lit *nodelay;
+    struct arg_int *mss;
+    struct arg_lit *autotune;
+    struct arg_int *iov;
     struct arg_end *end;
 } iperf_args_t;
 
+typedef struct {
+    iperf_cfg_t cfg;  /* configuration of each stream */
+    int max_streams;
+    double max_loss;  /* throughput search: loss threshold in percent */
+    QueueHandle_t reports;  /* iperf_cmd_sweep_report_t of closed instances */
+    uint32_t trial;  /* number of the running trial */
+    iperf_id_t ids[IPERF_SOCKET_MAX_NUM];  /* instances of the running trial */
+    volatile int ids_num;
+    volatile bool is_running;
+    volatile bool abort;
+} iperf_cmd_sweep_t;
+
+/* traffic report of a closed instance, tagged with its trial so that a late report is not counted for the next one */
+typedef struct {
+    uint32_t trial;
+    iperf_id_t id;
+    iperf_traffic_report_t traffic;
+} iperf_cmd_sweep_report_t;
+
 static iperf_args_t iperf_args;
 static iperf_state_handler_func_t s_iperf_state_hndl;
 static void *s_iperf_state_priv;
+static iperf_cmd_sweep_t s_sweep;
+
+/* summary of one sweep step or search trial */
+typedef struct {
+    uint64_t bytes;
+    uint64_t cpu_time_us;
+    uint32_t end_sec;
+    uint32_t datagrams;  /* UDP: received datagrams as reported by the server */
+    uint32_t lost;
+    int32_t sndbuf_len;  /* socket buffer sizes read back from the socket layer, 0 if not set or refused */
+    int32_t rcvbuf_len;
+    int streams;  /* streams which finished */
+} iperf_cmd_trial_t;
+
+/* datagram lengths of the throughput search */
+static const uint32_t s_search_lens[] = { 64, 128, 256, 512, 1024, 1280, 1470 };
+/* socket buffer sizes and write lengths probed by the socket tuning, 0 for the socket layer default */
+static const uint32_t s_autotune_buf_lens[] = { 0, 8192, 32768, 131072 };
+static const uint32_t s_autotune_tcp_lens[] = { 536, 1460, 2920, 8192, 16384, 65536 };
+static const uint32_t s_autotune_udp_lens[] = { 512, 1024, 1470 };
 
 static int32_t iperf_bandwidth_convert(const char *bandwidth_str)
 {
@@ -102,6 +187,500 @@ static int32_t iperf_bandwidth_convert(const char *bandwidth_str)
     }
 }
 
+/* bandwidth ramp "<start>,<step>,<secs>[,<max>]", bandwidths in #[kmgKMG] */
+static bool iperf_ramp_convert(const char *ramp_str, iperf_cfg_t *cfg)
+{
+    char buf[64];
+    char *save = NULL;
+    char *field[4] = { 0 };
+    int count = 0;
+
+    snprintf(buf, sizeof(buf), "%s", ramp_str);
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL && count < 4; tok = strtok_r(NULL, ",", &save)) {
+        field[count++] = tok;
+    }
+    if (count < 3) {
+        return false;
+    }
+    cfg->bw_lim = iperf_bandwidth_convert(field[0]);
+    cfg->ramp.step_bw = iperf_bandwidth_convert(field[1]);
+    cfg->ramp.step_sec = strtol(field[2], NULL, 10);
+    cfg->ramp.max_bw = count > 3 ? iperf_bandwidth_convert(field[3]) : 0;
+    return cfg->bw_lim > 0 && cfg->ramp.step_bw > 0 && (int32_t)cfg->ramp.step_sec > 0 && cfg->ramp.max_bw >= 0;
+}
+
+/* load co-runner "<duty %>[,<step %>,<secs>]" */
+static bool iperf_load_convert(const char *load_str, iperf_cfg_t *cfg)
+{
+    char *end = NULL;
+    long duty = strtol(load_str, &end, 10);
+    long step = 0;
+    long secs = 0;
+
+    if (end == load_str || duty < 0 || duty > 100) {
+        return false;
+    }
+    if (*end == ',') {
+        const char *step_str = end + 1;
+        step = strtol(step_str, &end, 10);
+        if (end == step_str || *end != ',' || step <= 0 || step > 100) {
+            return false;
+        }
+        const char *secs_str = end + 1;
+        secs = strtol(secs_str, &end, 10);
+        if (end == secs_str || secs <= 0) {
+            return false;
+        }
+    }
+    if (*end != '\0' || (duty == 0 && step == 0)) {
+        return false;
+    }
+    cfg->load.duty_percent = duty;
+    cfg->load.step_percent = step;
+    cfg->load.step_sec = secs;
+    return true;
+}
+
+/* isochronous frames "<fps>:<mean>[,<stdev>]", bandwidths in #[kmgKMG] */
+static bool iperf_isoch_convert(const char *isoch_str, iperf_cfg_t *cfg)
+{
+    char buf[64];
+    char *save = NULL;
+
+    snprintf(buf, sizeof(buf), "%s", isoch_str);
+    char *fps = strtok_r(buf, ":", &save);
+    char *mean = strtok_r(NULL, ",", &save);
+    char *stdev = strtok_r(NULL, ",", &save);
+    if (fps == NULL || mean == NULL) {
+        return false;
+    }
+    cfg->isoch.fps = strtol(fps, NULL, 10);
+    cfg->isoch.mean_bw = iperf_bandwidth_convert(mean);
+    cfg->isoch.stdev_bw = stdev ? iperf_bandwidth_convert(stdev) : 0;
+    // a deviation of 0 converts to IPERF_DEFAULT_NO_BW_LIMIT, frames of the same size
+    cfg->isoch.stdev_bw = MAX(cfg->isoch.stdev_bw, 0);
+    return (int32_t)cfg->isoch.fps > 0 && cfg->isoch.mean_bw > 0;
+}
+
+/* arrival process "poisson" or "onoff:<on ms>,<off ms>" */
+static bool iperf_model_convert(const char *model_str, iperf_cfg_t *cfg)
+{
+    char buf[64];
+    char *save = NULL;
+
+    snprintf(buf, sizeof(buf), "%s", model_str);
+    char *name = strtok_r(buf, ":", &save);
+    if (name == NULL) {
+        return false;
+    }
+    if (strcmp(name, "poisson") == 0) {
+        cfg->model.arrival = IPERF_ARRIVAL_POISSON;
+        return true;
+    }
+    char *on_ms = strtok_r(NULL, ",", &save);
+    char *off_ms = strtok_r(NULL, ",", &save);
+    if (strcmp(name, "onoff") != 0 || on_ms == NULL || off_ms == NULL) {
+        return false;
+    }
+    cfg->model.arrival = IPERF_ARRIVAL_ON_OFF;
+    cfg->model.on_ms = strtol(on_ms, NULL, 10);
+    cfg->model.off_ms = strtol(off_ms, NULL, 10);
+    return (int32_t)cfg->model.on_ms > 0 && (int32_t)cfg->model.off_ms > 0;
+}
+
+/* send backoff "yield | delay[:<max ms>] | select[:<max ms>]" */
+static bool iperf_backoff_convert(const char *backoff_str, iperf_cfg_t *cfg)
+{
+    char buf[32];
+    char *save = NULL;
+
+    snprintf(buf, sizeof(buf), "%s", backoff_str);
+    char *name = strtok_r(buf, ":", &save);
+    char *max_ms = strtok_r(NULL, ":", &save);
+    if (name == NULL) {
+        return false;
+    }
+    if (strcmp(name, "yield") == 0) {
+        cfg->backoff.policy = IPERF_BACKOFF_YIELD;
+        return max_ms == NULL;
+    } else if (strcmp(name, "delay") == 0) {
+        cfg->backoff.policy = IPERF_BACKOFF_DELAY;
+    } else if (strcmp(name, "select") == 0) {
+        cfg->backoff.policy = IPERF_BACKOFF_SELECT;
+    } else {
+        return false;
+    }
+    if (max_ms != NULL) {
+        long value = strtol(max_ms, NULL, 10);
+        if (value <= 0 || value > UINT16_MAX) {
+            return false;
+        }
+        cfg->backoff.max_delay_ms = value;
+    }
+    return true;
+}
+
+/* datagram length mix "<len>:<weight>[,<len>:<weight>...]" */
+static bool iperf_imix_convert(const char *imix_str, iperf_cfg_t *cfg)
+{
+    char buf[128];
+    char *save = NULL;
+    int count = 0;
+
+    snprintf(buf, sizeof(buf), "%s", imix_str);
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        char *weight = strchr(tok, ':');
+        if (count == IPERF_IMIX_MAX_LENS || weight == NULL) {
+            return false;
+        }
+        long len = strtol(tok, NULL, 10);
+        long w = strtol(weight + 1, NULL, 10);
+        if (len <= 0 || len > UINT16_MAX || w <= 0 || w > UINT16_MAX) {
+            return false;
+        }
+        cfg->model.imix[count].len = len;
+        cfg->model.imix[count].weight = w;
+        count++;
+    }
+    return count > 0;
+}
+
+/* bandwidth in the units of the given output format */
+static double iperf_cmd_bandwidth(double bytes_per_sec, iperf_output_format_t format, const char **unit)
+{
+    switch (format) {
+    case BITS_PER_SEC:
+        *unit = "bits/sec";
+        return bytes_per_sec * 8;
+    case KBITS_PER_SEC:
+        *unit = "Kbits/sec";
+        return bytes_per_sec * 8 / 1000.0;
+    case KBYTES_PER_SEC:
+        *unit = "KBytes/sec";
+        return bytes_per_sec / 1024.0;
+    case MBYTES_PER_SEC:
+        *unit = "MBytes/sec";
+        return bytes_per_sec / 1024.0 / 1024.0;
+    case MBITS_PER_SEC:
+    default:
+        *unit = "Mbits/sec";
+        return bytes_per_sec * 8 / 1000.0 / 1000.0;
+    }
+}
+
+/* priv: number of the trial which started the instance */
+static void iperf_cmd_sweep_state_handler(iperf_id_t id, iperf_state_data_t *data, void *priv)
+{
+    if (data->state == IPERF_CLOSED) {
+        iperf_cmd_sweep_report_t report = {
+            .trial = (uint32_t)(uintptr_t)priv,
+            .id = id,
+        };
+        iperf_get_traffic_report(id, &report.traffic);
+        xQueueSend(s_sweep.reports, &report, 0);
+    }
+    if (s_iperf_state_hndl) {
+        s_iperf_state_hndl(id, data, s_iperf_state_priv);
+    }
+}
+
+/* an instance of the running sweep trial, aborting it aborts the sweep */
+static bool iperf_cmd_sweep_has_instance(iperf_id_t id)
+{
+    for (int i = 0; i < s_sweep.ids_num; i++) {
+        if (s_sweep.ids[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* start streams instances of cfg and wait until all of them closed, returns false if no traffic passed */
+static bool iperf_cmd_sweep_run_trial(iperf_cmd_sweep_t *sweep, const iperf_cfg_t *cfg, int streams, iperf_cmd_trial_t *trial)
+{
+    iperf_cmd_sweep_report_t report;
+    iperf_cfg_t trial_cfg = *cfg;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS((cfg->time + IPERF_CMD_SWEEP_CLOSE_MARGIN_SEC) * 1000);
+    int started = 0;
+
+    memset(trial, 0, sizeof(iperf_cmd_trial_t));
+    // reports of an earlier trial which did not finish in time are discarded by their tag
+    xQueueReset(sweep->reports);
+    sweep->trial++;
+    trial_cfg.state_handler_priv = (void *)(uintptr_t)sweep->trial;
+    sweep->ids_num = 0;
+    for (int i = 0; i < streams; i++) {
+        iperf_id_t id = iperf_start_instance(&trial_cfg);
+        if (id >= 0) {
+            sweep->ids[started++] = id;
+            sweep->ids_num = started;
+        }
+    }
+    if (started != streams) {
+        ESP_LOGE(APP_TAG, "sweep: only %d of %d streams started", started, streams);
+    }
+    while (trial->streams < started) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xQueueReceive(sweep->reports, &report, timeout - elapsed) != pdTRUE) {
+            ESP_LOGE(APP_TAG, "sweep: stream did not finish in time");
+            for (int i = 0; i < started; i++) {
+                iperf_stop_instance(sweep->ids[i]);
+            }
+            break;
+        }
+        if (report.trial != sweep->trial) {
+            continue;
+        }
+        trial->bytes += report.traffic.total_transfer_bytes;
+        trial->cpu_time_us += report.traffic.cpu_time_us;
+        trial->end_sec = MAX(trial->end_sec, report.traffic.end_sec);
+        trial->datagrams += report.traffic.total_datagrams;
+        trial->lost += report.traffic.total_lost_datagrams;
+        trial->sndbuf_len = report.traffic.sndbuf_len;
+        trial->rcvbuf_len = report.traffic.rcvbuf_len;
+        trial->streams++;
+    }
+    sweep->ids_num = 0;
+    return trial->streams > 0 && trial->end_sec > 0;
+}
+
+/* run the test with 1, 2, 4 ... max_streams parallel streams and print how the bandwidth scales */
+static void iperf_cmd_sweep_task(void *arg)
+{
+    iperf_cmd_sweep_t *sweep = (iperf_cmd_sweep_t *)arg;
+    iperf_cmd_trial_t trial;
+    const char *unit = "";
+    double single_bw = 0;
+    double prev_bw = 0;
+    int knee = 0;
+
+    printf("\nStreams\tAggregate\tPer-stream\tCPU\tEfficiency\n");
+    for (int streams = 1; streams <= sweep->max_streams && !sweep->abort; ) {
+        if (!iperf_cmd_sweep_run_trial(sweep, &sweep->cfg, streams, &trial)) {
+            ESP_LOGE(APP_TAG, "sweep: no traffic with %d streams, stopped", streams);
+            break;
+        }
+
+        double aggregate = iperf_cmd_bandwidth((double)trial.bytes / trial.end_sec, sweep->cfg.format, &unit);
+        if (streams == 1) {
+            single_bw = aggregate;
+        }
+        if (knee == 0 && prev_bw > 0 && aggregate < prev_bw * IPERF_CMD_SWEEP_KNEE_GAIN) {
+            knee = streams;
+        }
+        prev_bw = aggregate;
+        printf("%4d\t%.2f %s\t%.2f %s\t", streams, aggregate, unit, aggregate / trial.streams, unit);
+        if (trial.cpu_time_us != 0) {
+            // CPU time of the traffic tasks relative to one core
+            printf("%.1f%%", trial.cpu_time_us / 10000.0 / trial.end_sec);
+        } else {
+            printf("n/a");
+        }
+        printf("\t%.1f%%\n", single_bw > 0 ? 100.0 * aggregate / (single_bw * streams) : 0);
+
+        if (streams == sweep->max_streams) {
+            break;
+        }
+        streams = MIN(streams * 2, sweep->max_streams);
+        vTaskDelay(pdMS_TO_TICKS(IPERF_CMD_SWEEP_STEP_DELAY_MS));
+    }
+    if (knee != 0) {
+        printf("aggregate bandwidth gains less than %.0f%% from %d streams on\n", (IPERF_CMD_SWEEP_KNEE_GAIN - 1) * 100, knee);
+    }
+    /* log for test scripts */
+    ESP_LOGI(APP_TAG, "DONE.IPERF_SWEEP,%s", sweep->abort ? "ABORTED" : "OK");
+
+    vQueueDelete(sweep->reports);
+    sweep->reports = NULL;
+    sweep->is_running = false;
+    vTaskDelete(NULL);
+}
+
+/*
+ * RFC 2544 style throughput search: for each datagram length, binary search on the bandwidth limit for the highest
+ * rate with receiver side loss not above max_loss. The first trial runs at the highest rate (-b or unlimited) and bounds
+ * the search. The loss is reported back by the server at the end of each trial.
+ */
+static void iperf_cmd_search_task(void *arg)
+{
+    iperf_cmd_sweep_t *sweep = (iperf_cmd_sweep_t *)arg;
+    const uint32_t *lens = s_search_lens;
+    size_t lens_num = sizeof(s_search_lens) / sizeof(s_search_lens[0]);
+    iperf_cmd_trial_t trial;
+    const char *unit = "";
+    bool failed = false;
+
+    if (sweep->cfg.len_send_buf != 0) {
+        lens = &sweep->cfg.len_send_buf;
+        lens_num = 1;
+    }
+    printf("\nLength\tThroughput\tLoss\tTrials\n");
+    for (size_t i = 0; i < lens_num && !sweep->abort && !failed; i++) {
+        iperf_cfg_t cfg = sweep->cfg;
+        double best_rate = 0;  /* bits/sec */
+        double best_loss = 0;
+        double low = 0;
+        double high = 0;
+        int trials = 0;
+
+        cfg.len_send_buf = lens[i];
+        do {
+            if (trials > 0) {
+                cfg.bw_lim = (low + high) / 2;
+                vTaskDelay(pdMS_TO_TICKS(IPERF_CMD_SWEEP_STEP_DELAY_MS));
+            }
+            trials++;
+            if (!iperf_cmd_sweep_run_trial(sweep, &cfg, 1, &trial)) {
+                ESP_LOGE(APP_TAG, "search: no traffic at length %" PRIu32 ", stopped", cfg.len_send_buf);
+                failed = true;
+                break;
+            }
+            if (trial.datagrams + trial.lost == 0) {
+                ESP_LOGE(APP_TAG, "search: the server did not report its statistics, stopped");
+                failed = true;
+                break;
+            }
+            double rate = trial.bytes * 8.0 / trial.end_sec;
+            double loss = 100.0 * trial.lost / (trial.datagrams + trial.lost);
+            ESP_LOGI(APP_TAG, "search: length %" PRIu32 ", %.0f bits/sec, loss %.3f%%", cfg.len_send_buf, rate, loss);
+            if (trials == 1) {
+                high = rate;
+            }
+            if (loss <= sweep->max_loss) {
+                low = trials == 1 ? high : cfg.bw_lim;
+                best_rate = rate;
+                best_loss = loss;
+            } else if (trials > 1) {
+                high = cfg.bw_lim;
+            }
+        } while (!sweep->abort && trials < IPERF_CMD_SEARCH_MAX_TRIALS && high - low > high * IPERF_CMD_SEARCH_RESOLUTION);
+        if (failed) {
+            break;
+        }
+        double throughput = iperf_cmd_bandwidth(best_rate / 8, cfg.format, &unit);
+        printf("%5" PRIu32 "\t%.2f %s\t%.3f%%\t%d\n", cfg.len_send_buf, throughput, unit, best_loss, trials);
+    }
+    /* log for test scripts */
+    ESP_LOGI(APP_TAG, "DONE.IPERF_SEARCH,%s", failed ? "FAIL" : sweep->abort ? "ABORTED" : "OK");
+
+    vQueueDelete(sweep->reports);
+    sweep->reports = NULL;
+    sweep->is_running = false;
+    vTaskDelete(NULL);
+}
+
+/*
+ * Socket tuning: one probe of each socket buffer size and write length (-w and -l fix one of them), the combination
+ * with the highest throughput is printed as options for the next tests. The sizes the socket layer applied are read
+ * back and shown as SO_SNDBUF/SO_RCVBUF. A size it refused entirely is not probed further and never recommended, the
+ * probe would only measure the default again.
+ */
+static void iperf_cmd_autotune_task(void *arg)
+{
+    iperf_cmd_sweep_t *sweep = (iperf_cmd_sweep_t *)arg;
+    const uint32_t *buf_lens = s_autotune_buf_lens;
+    size_t buf_lens_num = sizeof(s_autotune_buf_lens) / sizeof(s_autotune_buf_lens[0]);
+    const uint32_t *lens = s_autotune_tcp_lens;
+    size_t lens_num = sizeof(s_autotune_tcp_lens) / sizeof(s_autotune_tcp_lens[0]);
+    iperf_cmd_trial_t trial;
+    const char *unit = "";
+    double best_bw = 0;
+    uint32_t best_buf_len = 0;
+    uint32_t best_len = 0;
+    bool failed = false;
+
+    if (sweep->cfg.flag & IPERF_FLAG_UDP) {
+        lens = s_autotune_udp_lens;
+        lens_num = sizeof(s_autotune_udp_lens) / sizeof(s_autotune_udp_lens[0]);
+    }
+    if (sweep->cfg.socket_buf_len != 0) {
+        buf_lens = &sweep->cfg.socket_buf_len;
+        buf_lens_num = 1;
+    }
+    if (sweep->cfg.len_send_buf != 0) {
+        lens = &sweep->cfg.len_send_buf;
+        lens_num = 1;
+    }
+    printf("\nWindow\tApplied\tLength\tThroughput\n");
+    for (size_t i = 0; i < buf_lens_num && !sweep->abort && !failed; i++) {
+        for (size_t j = 0; j < lens_num && !sweep->abort; j++) {
+            iperf_cfg_t cfg = sweep->cfg;
+
+            cfg.socket_buf_len = buf_lens[i];
+            cfg.len_send_buf = lens[j];
+            if (i + j > 0) {
+                vTaskDelay(pdMS_TO_TICKS(IPERF_CMD_SWEEP_STEP_DELAY_MS));
+            }
+            if (!iperf_cmd_sweep_run_trial(sweep, &cfg, 1, &trial)) {
+                ESP_LOGE(APP_TAG, "autotune: no traffic with window %" PRIu32 ", length %" PRIu32 ", stopped", cfg.socket_buf_len, cfg.len_send_buf);
+                failed = true;
+                break;
+            }
+            if (cfg.socket_buf_len != 0 && trial.sndbuf_len == 0 && trial.rcvbuf_len == 0) {
+                printf("%" PRIu32 "\trefused by the socket layer\n", cfg.socket_buf_len);
+                break;
+            }
+            double bw = (double)trial.bytes / trial.end_sec;
+            if (bw > best_bw) {
+                best_bw = bw;
+                best_buf_len = cfg.socket_buf_len;
+                best_len = cfg.len_send_buf;
+            }
+            double throughput = iperf_cmd_bandwidth(bw, cfg.format, &unit);
+            if (cfg.socket_buf_len == 0) {
+                printf("default\t-\t");
+            } else {
+                printf("%" PRIu32 "\t%" PRIi32 "/%" PRIi32 "\t", cfg.socket_buf_len, trial.sndbuf_len, trial.rcvbuf_len);
+            }
+            printf("%5" PRIu32 "\t%.2f %s\n", cfg.len_send_buf, throughput, unit);
+        }
+    }
+    if (best_bw > 0) {
+        double throughput = iperf_cmd_bandwidth(best_bw, sweep->cfg.format, &unit);
+        if (best_buf_len == 0) {
+            printf("best: -l %" PRIu32 ", %.2f %s\n", best_len, throughput, unit);
+        } else {
+            printf("best: -w %" PRIu32 " -l %" PRIu32 ", %.2f %s\n", best_buf_len, best_len, throughput, unit);
+        }
+    }
+    /* log for test scripts */
+    ESP_LOGI(APP_TAG, "DONE.IPERF_AUTOTUNE,%s", failed ? "FAIL" : sweep->abort ? "ABORTED" : "OK");
+
+    vQueueDelete(sweep->reports);
+    sweep->reports = NULL;
+    sweep->is_running = false;
+    vTaskDelete(NULL);
+}
+
+static int iperf_cmd_start_sweep(const iperf_cfg_t *cfg, int max_streams, TaskFunction_t task)
+{
+    if (s_sweep.is_running) {
+        ESP_LOGE(APP_TAG, "a sweep is already running");
+        return 1;
+    }
+    // room for the reports of a trial and the late ones of the trial before
+    s_sweep.reports = xQueueCreate(2 * max_streams, sizeof(iperf_cmd_sweep_report_t));
+    if (s_sweep.reports == NULL) {
+        ESP_LOGE(APP_TAG, "sweep: not enough memory");
+        return 1;
+    }
+    s_sweep.cfg = *cfg;
+    s_sweep.cfg.state_handler = iperf_cmd_sweep_state_handler;
+    s_sweep.max_streams = max_streams;
+    s_sweep.abort = false;
+    s_sweep.is_running = true;
+    if (xTaskCreate(task, IPERF_CMD_SWEEP_TASK_NAME, IPERF_CMD_SWEEP_TASK_STACK, &s_sweep,
+                    IPERF_REPORT_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(APP_TAG, "sweep: failed to create task");
+        vQueueDelete(s_sweep.reports);
+        s_sweep.reports = NULL;
+        s_sweep.is_running = false;
+        return 1;
+    }
+    return 0;
+}
+
 static int cmd_do_iperf(int argc, char **argv)
 {
     int nerrors = arg_parse(argc, argv, (void **) &iperf_args);
@@ -122,8 +701,13 @@ static int cmd_do_iperf(int argc, char **argv)
 
     if (iperf_args.abort->count != 0) {
         if(iperf_args.id->count == 0) {
+            // no further sweep steps
+            s_sweep.abort = true;
             iperf_stop_instance(IPERF_ALL_INSTANCES_ID);
         } else {
+            if (s_sweep.is_running && iperf_cmd_sweep_has_instance(iperf_args.id->ival[0])) {
+                s_sweep.abort = true;
+            }
             iperf_stop_instance(iperf_args.id->ival[0]);
         }
         /* log for test scriptes */
@@ -131,6 +715,33 @@ static int cmd_do_iperf(int argc, char **argv)
         return 0;
     }
 
+    if (iperf_args.set_bw->count != 0) {
+        if (iperf_args.id->count == 0) {
+            ESP_LOGE(APP_TAG, "set-bw option needs the instance id");
+            return 1;
+        }
+        int32_t bw_lim = iperf_bandwidth_convert(iperf_args.set_bw->sval[0]);
+        if (bw_lim <= 0 || iperf_set_bandwidth(iperf_args.id->ival[0], bw_lim) != ESP_OK) {
+            ESP_LOGE(APP_TAG, "failed to set bandwidth");
+            return 1;
+        }
+        ESP_LOGI(APP_TAG, "DONE.IPERF_SET_BW,OK");
+        return 0;
+    }
+
+    /* next run of a parked warm instance with the configuration of its last run */
+    if (iperf_args.restart->count > 0 && iperf_args.ip->count == 0 && iperf_args.server->count == 0) {
+        if ((iperf_args.id->count == 0) || (iperf_args.parallel->count > 0)) {
+            ESP_LOGE(APP_TAG, "restart option needs the instance id and should not be used with parallel option");
+            return 1;
+        }
+        if (iperf_restart_instance(iperf_args.id->ival[0], NULL) != ESP_OK) {
+            ESP_LOGE(APP_TAG, "failed to restart iperf instance");
+            return 1;
+        }
+        return 0;
+    }
+
     memset(&cfg, 0, sizeof(cfg));
 
     /* Given instance id */
@@ -183,11 +794,180 @@ static int cmd_do_iperf(int argc, char **argv)
         cfg.flag |= IPERF_FLAG_UDP;
     }
 
+    if (iperf_args.rr->count > 0) {
+        cfg.flag |= IPERF_FLAG_RR;
+    }
+    if (iperf_args.crr->count > 0) {
+        if (iperf_args.udp->count > 0) {
+            ESP_LOGE(APP_TAG, "connection rate mode is TCP only");
+            return 1;
+        }
+        cfg.flag |= IPERF_FLAG_RR | IPERF_FLAG_CRR;
+    }
+    if (iperf_args.daemon->count > 0) {
+        if (iperf_args.server->count == 0) {
+            ESP_LOGE(APP_TAG, "daemon mode is for server only");
+            return 1;
+        }
+        cfg.flag |= IPERF_FLAG_DAEMON;
+    }
+    if (iperf_args.warm->count > 0) {
+        cfg.flag |= IPERF_FLAG_WARM;
+    }
+    if (iperf_args.keep_conn->count > 0) {
+        if ((iperf_args.server->count > 0) || (iperf_args.udp->count > 0)) {
+            ESP_LOGE(APP_TAG, "keep-conn option is for TCP client only");
+            return 1;
+        }
+        cfg.flag |= IPERF_FLAG_WARM | IPERF_FLAG_KEEP_CONN;
+    }
+    if (iperf_args.verify->count > 0) {
+        cfg.flag |= IPERF_FLAG_VERIFY;
+    }
+    if (iperf_args.window->count > 0) {
+        if (iperf_args.window->ival[0] <= 0) {
+            ESP_LOGE(APP_TAG, "invalid socket buffer size");
+            return 1;
+        }
+        cfg.socket_buf_len = iperf_args.window->ival[0];
+    }
+    if (iperf_args.nodelay->count > 0) {
+        if (iperf_args.udp->count > 0) {
+            ESP_LOGE(APP_TAG, "nodelay option is for TCP only");
+            return 1;
+        }
+        cfg.flag |= IPERF_FLAG_NODELAY;
+    }
+    if (iperf_args.mss->count > 0) {
+        if (iperf_args.udp->count > 0 || iperf_args.mss->ival[0] <= 0 || iperf_args.mss->ival[0] > UINT16_MAX) {
+            ESP_LOGE(APP_TAG, "mss option is for TCP only, should be in range 1~%d", UINT16_MAX);
+            return 1;
+        }
+        cfg.mss = iperf_args.mss->ival[0];
+    }
+    if (iperf_args.file->count > 0) {
+        if (iperf_args.server->count > 0) {
+            ESP_LOGE(APP_TAG, "file option is for client only");
+            return 1;
+        }
+        cfg.file_path = iperf_args.file->sval[0];
+    }
+    if (iperf_args.write->count > 0) {
+        if (iperf_args.server->count == 0) {
+            ESP_LOGE(APP_TAG, "write option is for server only");
+            return 1;
+        }
+        cfg.write_path = iperf_args.write->sval[0];
+    }
+    if (iperf_args.isochronous->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count == 0 || !iperf_isoch_convert(iperf_args.isochronous->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "isochronous option is for UDP client, format: <fps>:<mean>[,<stdev>]");
+            return 1;
+        }
+    }
+    if (iperf_args.model->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count == 0 || !iperf_model_convert(iperf_args.model->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "model option is for UDP client, format: poisson | onoff:<on ms>,<off ms>");
+            return 1;
+        }
+    }
+    if (iperf_args.imix->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count == 0 || !iperf_imix_convert(iperf_args.imix->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "imix option is for UDP client, format: <len>:<weight>[,<len>:<weight>...] (at most %d lengths)", IPERF_IMIX_MAX_LENS);
+            return 1;
+        }
+    }
+    if (iperf_args.seed->count > 0) {
+        if (iperf_args.model->count == 0 && iperf_args.imix->count == 0) {
+            ESP_LOGE(APP_TAG, "seed option is for --model or --imix");
+            return 1;
+        }
+        cfg.model.seed = iperf_args.seed->ival[0];
+    }
+    if (iperf_args.trace->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count == 0) {
+            ESP_LOGE(APP_TAG, "trace option is for UDP client");
+            return 1;
+        }
+        cfg.trace_path = iperf_args.trace->sval[0];
+    }
+    if (iperf_args.trace_loop->count > 0) {
+        if (iperf_args.trace->count == 0) {
+            ESP_LOGE(APP_TAG, "trace-loop option is for --trace");
+            return 1;
+        }
+        cfg.trace_loop = true;
+    }
+    if (iperf_args.backoff->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count == 0 || !iperf_backoff_convert(iperf_args.backoff->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "backoff option is for UDP client, format: yield | delay[:<max ms>] | select[:<max ms>]");
+            return 1;
+        }
+    }
+    if (iperf_args.load->count > 0) {
+        if (!iperf_load_convert(iperf_args.load->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "invalid load, format: <duty %%>[,<step %%>,<secs>], duty cycles 0~100");
+            return 1;
+        }
+        // by default the load competes with the traffic task for its core
+        cfg.load.core = portNUM_PROCESSORS - 1;
+    }
+    if (iperf_args.load_core->count > 0 || iperf_args.load_priority->count > 0 || iperf_args.load_mem->count > 0) {
+        if (iperf_args.load->count == 0) {
+            ESP_LOGE(APP_TAG, "load-core, load-priority and load-mem options are for --load");
+            return 1;
+        }
+        if (iperf_args.load_core->count > 0) {
+            if (iperf_args.load_core->ival[0] < -1 || iperf_args.load_core->ival[0] >= portNUM_PROCESSORS) {
+                ESP_LOGE(APP_TAG, "invalid load core, should be in range -1~%d", portNUM_PROCESSORS - 1);
+                return 1;
+            }
+            cfg.load.core = iperf_args.load_core->ival[0];
+        }
+        if (iperf_args.load_priority->count > 0) {
+            if (iperf_args.load_priority->ival[0] <= 0 || iperf_args.load_priority->ival[0] >= configMAX_PRIORITIES) {
+                ESP_LOGE(APP_TAG, "invalid load priority, should be in range 1~%d", configMAX_PRIORITIES - 1);
+                return 1;
+            }
+            cfg.load.priority = iperf_args.load_priority->ival[0];
+        }
+        if (iperf_args.load_mem->count > 0) {
+            if (iperf_args.load_mem->ival[0] < 0) {
+                ESP_LOGE(APP_TAG, "invalid load buffer length");
+                return 1;
+            }
+            cfg.load.mem_len = iperf_args.load_mem->ival[0];
+        }
+    }
+    if (iperf_args.response->count > 0) {
+        if (!(cfg.flag & IPERF_FLAG_RR) || (iperf_args.server->count > 0)) {
+            ESP_LOGE(APP_TAG, "response option is for request/response client, the server answers what is requested");
+            return 1;
+        }
+        if (iperf_args.response->ival[0] < IPERF_RR_MIN_LEN || iperf_args.response->ival[0] > UINT16_MAX) {
+            ESP_LOGE(APP_TAG, "invalid response length, should be in range %d~%d", IPERF_RR_MIN_LEN, UINT16_MAX);
+            return 1;
+        }
+        cfg.rr_response_len = iperf_args.response->ival[0];
+    }
+
     if (iperf_args.length->count == 0) {
         cfg.len_send_buf = 0;
     } else {
+        if (iperf_args.length->ival[0] < 0) {
+            ESP_LOGE(APP_TAG, "invalid buffer length");
+            return 1;
+        }
         cfg.len_send_buf = iperf_args.length->ival[0];
     }
+    if (iperf_args.iov->count > 0) {
+        if (iperf_args.server->count > 0 || iperf_args.udp->count > 0 ||
+                iperf_args.iov->ival[0] < 1 || iperf_args.iov->ival[0] > IPERF_IOV_MAX_COUNT) {
+            ESP_LOGE(APP_TAG, "iov option is for TCP client, should be in range 1~%d", IPERF_IOV_MAX_COUNT);
+            return 1;
+        }
+        cfg.iov_count = iperf_args.iov->ival[0];
+    }
 
     if (iperf_args.bind->count != 0) {
 #if IPERF_IPV6_ENABLED
@@ -245,6 +1025,13 @@ static int cmd_do_iperf(int argc, char **argv)
     } else {
         cfg.bw_lim = iperf_bandwidth_convert(iperf_args.bw_limit->sval[0]);
     }
+    /* --ramp, its start bandwidth replaces -b */
+    if (iperf_args.ramp->count > 0) {
+        if (iperf_args.server->count > 0 || !iperf_ramp_convert(iperf_args.ramp->sval[0], &cfg)) {
+            ESP_LOGE(APP_TAG, "ramp option is for clients, format: <start>,<step>,<secs>[,<max>]");
+            return 1;
+        }
+    }
     /* -f --format */
     cfg.format = MBITS_PER_SEC;
     if (iperf_args.format->count > 0) {
@@ -263,6 +1050,24 @@ static int cmd_do_iperf(int argc, char **argv)
             ESP_LOGW(APP_TAG, "ignore invalid format: %c", format_ch);
         }
     }
+    /* --stats */
+    if (iperf_args.stats->count > 0) {
+        cfg.flag |= IPERF_FLAG_STATS;
+    }
+    /* iperf --transport */
+    if (iperf_args.transport->count > 0) {
+        const char *transport = iperf_args.transport->sval[0];
+        if (strcmp(transport, "socket") == 0) {
+            cfg.transport = IPERF_TRANSPORT_SOCKET;
+        } else if (strcmp(transport, "netconn") == 0) {
+            cfg.transport = IPERF_TRANSPORT_NETCONN;
+        } else if (strcmp(transport, "memory") == 0) {
+            cfg.transport = IPERF_TRANSPORT_MEMORY;
+        } else {
+            ESP_LOGE(APP_TAG, "invalid transport: %s", transport);
+            return 1;
+        }
+    }
     /* iperf --tos */
     if (iperf_args.tos->count > 0) {
         cfg.tos = iperf_args.tos->ival[0];
@@ -320,6 +1125,68 @@ static int cmd_do_iperf(int argc, char **argv)
             return 1;
         }
     }
+    /* stream count sweep */
+    if (iperf_args.sweep->count > 0) {
+        if ((iperf_args.server->count > 0) || (iperf_args.id->count > 0) || (iperf_args.parallel->count > 0)) {
+            ESP_LOGE(APP_TAG, "sweep option should not be used with server mode, specific instance id or parallel option");
+            return 1;
+        }
+        if (iperf_args.sweep->ival[0] < 1 || iperf_args.sweep->ival[0] > IPERF_SOCKET_MAX_NUM) {
+            ESP_LOGE(APP_TAG, "invalid sweep stream number");
+            return 1;
+        }
+        return iperf_cmd_start_sweep(&cfg, iperf_args.sweep->ival[0], iperf_cmd_sweep_task);
+    }
+    /* UDP throughput search */
+    if (iperf_args.search->count > 0) {
+        if (!(cfg.flag & IPERF_FLAG_CLIENT) || !(cfg.flag & IPERF_FLAG_UDP) || (cfg.flag & IPERF_FLAG_RR) ||
+                (iperf_args.id->count > 0) || (iperf_args.parallel->count > 0)) {
+            ESP_LOGE(APP_TAG, "search option is for a single UDP client");
+            return 1;
+        }
+        if (cfg.transport != IPERF_TRANSPORT_SOCKET) {
+            // the loss is reported back by the server, which only the socket transport carries
+            ESP_LOGE(APP_TAG, "search option needs socket transport");
+            return 1;
+        }
+        if (iperf_args.search->dval[0] < 0 || iperf_args.search->dval[0] >= 100) {
+            ESP_LOGE(APP_TAG, "invalid search loss threshold");
+            return 1;
+        }
+        if (iperf_args.time->count == 0) {
+            cfg.time = IPERF_CMD_SEARCH_TRIAL_SEC;
+        }
+        // one report per trial
+        cfg.interval = cfg.time;
+        s_sweep.max_loss = iperf_args.search->dval[0];
+        return iperf_cmd_start_sweep(&cfg, 1, iperf_cmd_search_task);
+    }
+    /* socket buffer size and write length tuning */
+    if (iperf_args.autotune->count > 0) {
+        if (!(cfg.flag & IPERF_FLAG_CLIENT) || (cfg.flag & IPERF_FLAG_RR) || (iperf_args.id->count > 0) ||
+                (iperf_args.parallel->count > 0) || (iperf_args.search->count > 0)) {
+            ESP_LOGE(APP_TAG, "autotune option is for a single client");
+            return 1;
+        }
+        if (iperf_args.time->count == 0) {
+            cfg.time = IPERF_CMD_AUTOTUNE_TRIAL_SEC;
+        }
+        // one report per probe
+        cfg.interval = cfg.time;
+        return iperf_cmd_start_sweep(&cfg, 1, iperf_cmd_autotune_task);
+    }
+    /* next run of a parked warm instance */
+    if (iperf_args.restart->count > 0) {
+        if ((iperf_args.id->count == 0) || (iperf_args.parallel->count > 0)) {
+            ESP_LOGE(APP_TAG, "restart option needs the instance id and should not be used with parallel option");
+            return 1;
+        }
+        if (iperf_restart_instance(cfg.instance_id, &cfg) != ESP_OK) {
+            ESP_LOGE(APP_TAG, "failed to restart iperf instance");
+            return 1;
+        }
+        return 0;
+    }
     for (int i = 0; i < parallel; i++) {
         iperf_start_instance(&cfg);
     }
@@ -360,12 +1227,44 @@ esp_err_t iperf_cmd_register_iperf(void)
     iperf_args.time = arg_int0("t", "time", "<time>", "time in seconds to transmit for (default 10 secs)");
     iperf_args.bw_limit = arg_str0("b", "bandwidth", "<bandwidth>", "#[kmgKMG]  bandwidth to send at in bits/sec");
     iperf_args.format = arg_str0("f", "format", "<format>", "'b' = bits/sec 'k' = Kbits/sec 'K' = Kbytes/sec 'm' = Mbits/sec 'M' = Mbytes/sec");
+    iperf_args.stats = arg_lit0(NULL, "stats", "print the lost/total datagrams of a UDP server, and the CPU time of the traffic task and the transport calls in the summary");
     iperf_args.tos = arg_int0("S", "tos", "<tos>", "set the socket's IP_TOS (byte) field");
     /* iperf instance id */
     iperf_args.id = arg_int0(NULL, "id", "<id>", "iperf instance ID. default: 'increase' for create, 'all' for abort.");
     /* abort is not an official option */
     iperf_args.abort = arg_lit0(NULL, "abort", "abort running iperf");
     iperf_args.parallel = arg_int0("P", "parallel", "<parallel number>", "number of parallel client threads to run");
+    iperf_args.transport = arg_str0(NULL, "transport", "<transport>", "'socket' (default), 'netconn' = lwIP netconn API, 'memory' = in-memory loopback (linux target only)");
+    iperf_args.sweep = arg_int0(NULL, "sweep", "<max streams>", "run successive client tests with 1, 2, 4 ... <max streams> parallel streams and print a scaling table");
+    iperf_args.search = arg_dbl0(NULL, "search", "<max loss %>", "UDP client: search the highest bandwidth with receiver loss not above <max loss %> for each datagram length (64-1470, or -l)");
+    iperf_args.rr = arg_lit0(NULL, "rr", "request/response mode: the client sends -l byte requests (default " STR(IPERF_RR_MIN_LEN) ") one at a time and reports transactions/sec and round trip times, the server echoes");
+    iperf_args.response = arg_int0(NULL, "response", "<length>", "request/response client: response length in bytes (default: request length)");
+    iperf_args.crr = arg_lit0(NULL, "crr", "TCP connection rate: like --rr with a new connection per transaction, reports connections/sec and connect times, the server keeps accepting");
+    iperf_args.daemon = arg_lit0("D", "daemon", "server: serve clients one after another with a summary per client, until aborted (-t is ignored)");
+    iperf_args.warm = arg_lit0(NULL, "warm", "keep tasks, timers and buffer after the run, run again with --restart --id=<id>, delete with --abort");
+    iperf_args.keep_conn = arg_lit0(NULL, "keep-conn", "TCP client: like --warm, and keep the connection open for the next run");
+    iperf_args.restart = arg_lit0(NULL, "restart", "run the parked warm instance --id=<id> again with the given options, without -c or -s with those of its last run");
+    iperf_args.set_bw = arg_str0(NULL, "set-bw", "<bandwidth>", "#[kmgKMG]  change the bandwidth of the running client --id=<id>, which was started with -b");
+    iperf_args.ramp = arg_str0(NULL, "ramp", "<start>,<step>,<secs>[,<max>]", "client: start at <start> bandwidth, add <step> every <secs> (a multiple of -i) up to <max>, each step is summarized");
+    iperf_args.verify = arg_lit0(NULL, "verify", "client sends a per stream pattern, server checks every byte and reports corrupted bytes and segments");
+    iperf_args.file = arg_str0("F", "file", "<path>", "client: send the content of <path> (repeated) instead of a zero filled buffer");
+    iperf_args.write = arg_str0(NULL, "write", "<path>", "server: write received data to <path>, the summary tells write stalls from network stalls");
+    iperf_args.isochronous = arg_str0(NULL, "isochronous", "<fps>:<mean>[,<stdev>]", "UDP client: send <fps> frames per second of normally distributed size, <mean> and <stdev> as bandwidth #[kmgKMG]");
+    iperf_args.model = arg_str0(NULL, "model", "<model>", "UDP client with -b: 'poisson' = exponentially distributed datagram gaps, 'onoff:<on ms>,<off ms>' = bursts and pauses of exponentially distributed length, averaging -b");
+    iperf_args.imix = arg_str0(NULL, "imix", "<len>:<weight>[,...]", "UDP client: draw datagram lengths from the weighted mix, e.g. 64:7,576:4,1470:1 (at most " STR(IPERF_IMIX_MAX_LENS) " lengths)");
+    iperf_args.seed = arg_int0(NULL, "seed", "<seed>", "seed of --model and --imix (default: derived from the instance id), the same seed repeats the traffic");
+    iperf_args.trace = arg_str0(NULL, "trace", "<path>", "UDP client: replay the send times and datagram lengths of the trace file <path> instead of -b, the test ends with the trace");
+    iperf_args.trace_loop = arg_lit0(NULL, "trace-loop", "UDP client: start the --trace over at its end until the test ends, the trace needs two send times at least");
+    iperf_args.load = arg_str0(NULL, "load", "<duty %>[,<step %>,<secs>]", "run a CPU load busy for <duty %> of the time next to each stream, add <step %> every <secs> (a multiple of -i), each load level is summarized");
+    iperf_args.load_core = arg_int0(NULL, "load-core", "<core>", "core of the --load (default: the traffic task core, -1 for any core)");
+    iperf_args.load_priority = arg_int0(NULL, "load-priority", "<priority>", "task priority of the --load (default: the traffic task priority)");
+    iperf_args.load_mem = arg_int0(NULL, "load-mem", "<bytes>", "make the --load copy through a <bytes> buffer (in PSRAM if available) to load the memory bus, instead of only spinning");
+    iperf_args.backoff = arg_str0(NULL, "backoff", "<policy>", "UDP client, after a send failed for lack of buffers: 'yield', 'delay[:<max ms>]' = sleep a doubling delay, 'select[:<max ms>]' = wait until writable, lwIP UDP sockets always are, so it sleeps a tick like delay (default: retry at once)");
+    iperf_args.window = arg_int0("w", "window", "<bytes>", "socket send and receive buffer sizes (SO_SNDBUF, SO_RCVBUF), if supported by the socket layer");
+    iperf_args.nodelay = arg_lit0("N", "nodelay", "TCP: set TCP_NODELAY, disabling Nagle's algorithm");
+    iperf_args.mss = arg_int0("M", "mss", "<bytes>", "TCP: set the maximum segment size (TCP_MAXSEG), if supported by the socket layer");
+    iperf_args.autotune = arg_lit0(NULL, "autotune", "client: probe socket buffer sizes (default, 8K-128K, or -w) and write lengths (or -l) for " STR(IPERF_CMD_AUTOTUNE_TRIAL_SEC) " secs (or -t) each and print the best combination, sizes the socket layer refuses are skipped");
+    iperf_args.iov = arg_int0(NULL, "iov", "<count>", "TCP client: gather each -l byte write from <count> iovecs of one buffer (1-" STR(IPERF_IOV_MAX_COUNT) "), -l may exceed 64 KB without allocating it, the unsent tail of a partial write is dropped so Bytes/call of --stats may be below -l");
     iperf_args.end = arg_end(1);
     const esp_console_cmd_t iperf_cmd = {
         .command = "iperf",
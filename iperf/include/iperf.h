@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2024-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -41,11 +41,22 @@ extern "C" {
 #define IPERF_FLAG_SERVER           BIT(1)
 #define IPERF_FLAG_TCP              BIT(2)
 #define IPERF_FLAG_UDP              BIT(3)
+#define IPERF_FLAG_STATS            BIT(4)  /* print the UDP server lost/total datagrams, and the CPU time and transport calls in the summary */
+#define IPERF_FLAG_RR               BIT(8)  /* request/response: client measures transactions and round trip times, server echoes */
+#define IPERF_FLAG_CRR              BIT(9)  /* TCP connection rate: request/response with a new connection per transaction */
+#define IPERF_FLAG_DAEMON           BIT(10)  /* server: serve clients one after another until stopped, with a summary per client */
+#define IPERF_FLAG_WARM             BIT(11)  /* keep tasks, timers and buffer after a run, see iperf_restart_instance() */
+#define IPERF_FLAG_KEEP_CONN        BIT(12)  /* warm TCP client: keep the connection open for the next run */
+#define IPERF_FLAG_VERIFY           BIT(13)  /* client sends a per stream pattern, server checks every received byte */
+#define IPERF_FLAG_NODELAY          BIT(14)  /* TCP: send segments at once, without Nagle's algorithm (TCP_NODELAY) */
 
 #define IPERF_DEFAULT_PORT          5001
 #define IPERF_DEFAULT_INTERVAL      3
 #define IPERF_DEFAULT_TIME          30
 #define IPERF_DEFAULT_NO_BW_LIMIT   -1
+#define IPERF_RR_MIN_LEN            8  /* request/response: requests and responses start with a header of this size */
+#define IPERF_UDP_MAX_LEN           65507  /* longest UDP datagram payload (IPv4) */
+#define IPERF_IOV_MAX_COUNT         64  /* most iovecs of a gathered send */
 
 #define IPERF_TRAFFIC_TASK_NAME "iperf_traffic"
 #define IPERF_DEFAULT_TRAFFIC_TASK_PRIORITY CONFIG_IPERF_DEF_TRAFFIC_TASK_PRIORITY
@@ -166,6 +177,46 @@ iperf_id_t iperf_start_instance(const iperf_cfg_t *cfg);
  */
 esp_err_t iperf_stop_instance(iperf_id_t id);
 
+/**
+ * @brief Change the bandwidth limit of a running instance
+ *
+ * Retunes the pacing of a client without stopping it, so its connection is kept. The new rate takes effect at the
+ * next pacing period.
+ *
+ * @note Only instances started with a bandwidth limit (`bw_lim` > 0) are paced.
+ *
+ * @param[in] id iperf instance ID
+ * @param[in] bw_lim new bandwidth limit in bits/s
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if invalid id or bandwidth is provided
+ *      - ESP_ERR_INVALID_STATE if the instance was not found
+ *      - ESP_ERR_NOT_SUPPORTED if the instance was started without bandwidth limit
+ */
+esp_err_t iperf_set_bandwidth(iperf_id_t id, int32_t bw_lim);
+
+/**
+ * @brief Run a warm instance again
+ *
+ * An instance started with `IPERF_FLAG_WARM` parks its tasks when its run ended, keeping its timers and buffer
+ * (and with `IPERF_FLAG_KEEP_CONN` its TCP connection), and reports `IPERF_PARKED` to the state handler.
+ * This function starts the next run without creating the instance again. `iperf_stop_instance()` deletes the
+ * instance, also while it is parked.
+ *
+ * @param[in] id iperf instance ID
+ * @param[in] cfg config of the next run, NULL to repeat the last one, a bandwidth ramp or changed bandwidth starts
+ *                over at the configured bandwidth. Role, protocol, transport and mode flags are those of the start,
+ *                the addresses are not changed while the connection is kept.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if invalid id or config is provided
+ *      - ESP_ERR_INVALID_STATE if the instance was not found or is not parked
+ *      - ESP_ERR_NO_MEM if the run needs a longer buffer which cannot be allocated
+ */
+esp_err_t iperf_restart_instance(iperf_id_t id, const iperf_cfg_t *cfg);
+
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2025-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -32,6 +32,10 @@ extern "C" {
     IPERF_TCP_CLIENT,
     IPERF_UDP_SERVER,
     IPERF_UDP_CLIENT,
+    IPERF_TCP_ECHO_SERVER,  /**< request/response server, answers every request */
+    IPERF_TCP_RR_CLIENT,  /**< request/response client */
+    IPERF_UDP_ECHO_SERVER,
+    IPERF_UDP_RR_CLIENT,
     IPERF_TRAFFIC_TYPE_INVALID,
 } iperf_traffic_type_t;
 
@@ -42,7 +46,8 @@ typedef enum {
     IPERF_STARTED,  /**< iperf started sending/receiving data */
     IPERF_STOPPED,  /**< iperf stopped sending/receiving data */
     IPERF_RUNNING,  /**< iperf is running and periodic report interval exceeded */
-    IPERF_CLOSED    /**< iperf instance finished its execution and is being closed */
+    IPERF_CLOSED,   /**< iperf instance finished its execution and is being closed */
+    IPERF_PARKED    /**< warm iperf instance finished its run and waits for iperf_restart_instance() */
 } iperf_state_t;
 
 /**
@@ -64,9 +69,88 @@ typedef int8_t iperf_id_t;
 typedef enum {
     IPERF_REPORT_CONNECT_INFO,  /**< iperf report connected info */
     IPERF_REPORT_PERIOD,  /**< iperf report period traffic */
-    IPERF_REPORT_SUMMARY  /**< iperf report traffic summary */
+    IPERF_REPORT_SUMMARY,  /**< iperf report traffic summary */
+    IPERF_REPORT_STEP  /**< iperf report traffic of one bandwidth ramp step, period fields cover the step */
 } iperf_report_type_t;
 
+/**
+ * @brief Iperf transport, the layer which carries the traffic
+ */
+typedef enum {
+    IPERF_TRANSPORT_SOCKET,  /**< BSD sockets (default) */
+    IPERF_TRANSPORT_NETCONN,  /**< lwIP netconn API, avoids copying payload where lwIP allows it */
+    IPERF_TRANSPORT_MEMORY,  /**< in-memory loopback between instances, linux target only */
+} iperf_transport_type_t;
+
+/**
+ * @brief Transport statistics of an iperf instance
+ */
+typedef struct {
+    uint64_t send_calls;  /**< send operations issued to the transport */
+    uint64_t recv_calls;  /**< receive operations issued to the transport */
+    uint64_t errors;  /**< failed send/receive operations, including expected ones under load (e.g. ENOBUFS) */
+    uint64_t drops;  /**< data dropped inside the transport, if the transport reports it */
+} iperf_transport_stats_t;
+
+/**
+ * @brief File statistics of a client with a payload file or a server writing to a file
+ *
+ * The traffic loop either waits for the file or for the network, the larger of both times shows the bottleneck.
+ */
+typedef struct {
+    uint64_t read_bytes;  /**< client: bytes taken from the file, it starts over at its end */
+    uint64_t file_wait_us;  /**< time the traffic loop waited for file data (client) or for writes to complete (server) */
+    uint64_t send_us;  /**< client: time the traffic loop spent in send calls */
+    uint64_t write_bytes;  /**< server: bytes written to the file */
+    uint64_t recv_us;  /**< server: time the traffic loop spent in receive calls */
+} iperf_file_stats_t;
+
+/**
+ * @brief Round trip times of request/response traffic
+ */
+typedef struct {
+    uint32_t min_us;  /**< shortest round trip in microseconds */
+    uint32_t avg_us;  /**< mean round trip */
+    uint32_t p50_us;  /**< median round trip */
+    uint32_t p90_us;  /**< 90th percentile */
+    uint32_t p99_us;  /**< 99th percentile */
+    uint32_t max_us;  /**< longest round trip */
+    uint32_t timeouts;  /**< UDP: transactions given up after the response timeout */
+} iperf_rtt_stats_t;
+
+/**
+ * @brief Isochronous frame statistics
+ *
+ * The frame latency is the time from the scheduled frame start at the client to its last datagram at the server, it needs
+ * synchronized clocks (e.g. SNTP). Late frames do not: they are compared with the fastest frame.
+ */
+typedef struct {
+    uint32_t frames;  /**< client: frames sent. Server: frames received complete */
+    uint32_t slipped_frames;  /**< client: frames sent when the next frame was due already */
+    uint32_t incomplete_frames;  /**< server: frames with lost datagrams, including frames lost entirely */
+    uint32_t late_frames;  /**< server: complete frames slower than the fastest one by more than a frame interval */
+    iperf_rtt_stats_t latency;  /**< server: frame completion latency, timeouts are not used */
+    bool is_sent;  /**< statistics of a client */
+} iperf_isoch_stats_t;
+
+/**
+ * @brief Trace replay statistics of a client
+ */
+typedef struct {
+    uint32_t datagrams;  /**< datagrams replayed */
+    uint32_t loops;  /**< passes over the trace completed */
+    iperf_rtt_stats_t timing_error;  /**< deviation of the send times from the trace */
+} iperf_trace_stats_t;
+
+/**
+ * @brief Load co-runner statistics, see iperf_load_cfg_t
+ */
+typedef struct {
+    uint8_t duty_percent;  /**< duty cycle of the last load level */
+    uint64_t busy_wall_us;  /**< wall-clock time of the busy periods of the load task, including time it was preempted */
+    uint64_t mem_bytes;  /**< bytes copied by a memory load */
+} iperf_load_stats_t;
+
 /**
  * @brief Structure of data for iperf report traffic data
  *
@@ -77,6 +161,44 @@ typedef enum {
     double period_bytes;  /**< data transferred in bytes within this period */
     iperf_output_format_t output_format;  /**< output format, bits/sec, Kbits/sec, Mbits/sec */
     uint64_t total_transfer_bytes;  /**< total bytes transferred since iperf has started */
+    uint64_t cpu_time_us;  /**< CPU time consumed by the traffic task in microseconds, only valid for SUMMARY (0 if not available) */
+    bool show_stats;  /**< IPERF_FLAG_STATS: the default output prints the lost/total datagrams, and cpu_time_us and transport_stats in the SUMMARY */
+    uint32_t period_datagrams;  /**< UDP server: datagrams received within this period */
+    uint32_t period_lost_datagrams;  /**< UDP server: datagrams lost within this period */
+    uint32_t total_datagrams;  /**< UDP server: datagrams received since iperf has started, UDP client: as reported by the server at the end of the test */
+    uint32_t total_lost_datagrams;  /**< UDP server: datagrams lost since iperf has started, UDP client: as reported by the server at the end of the test */
+    uint32_t total_out_of_order_datagrams;  /**< UDP server: datagrams received out of order since iperf has started */
+    uint32_t jitter_us;  /**< UDP server: interarrival jitter (RFC 3550) of the current client, from datagrams carrying their send time (0 if none), UDP client: as reported by the server at the end of the test */
+    iperf_transport_stats_t transport_stats;  /**< transport statistics, only valid for SUMMARY */
+    uint32_t period_transactions;  /**< request/response: transactions within this period */
+    uint32_t total_transactions;  /**< request/response: transactions since iperf has started */
+    iperf_rtt_stats_t rtt;  /**< request/response client: round trip times, only valid for SUMMARY */
+    uint32_t period_connections;  /**< TCP connection rate: connections established within this period */
+    uint32_t total_connections;  /**< TCP connection rate: connections established since iperf has started */
+    uint32_t period_connect_failures;  /**< TCP connection rate: failed connects or transactions within this period */
+    uint32_t total_connect_failures;  /**< TCP connection rate: failed connects or transactions since iperf has started */
+    iperf_rtt_stats_t connect_time;  /**< TCP connection rate client: socket creation and connect times, only valid for SUMMARY */
+    uint32_t start_latency_us;  /**< client: time from the start (or restart) call to the first send, including connect, only valid for SUMMARY */
+    uint32_t step;  /**< bandwidth ramp: step number from 1, only valid for STEP */
+    int32_t step_bw_lim;  /**< bandwidth ramp: bandwidth limit of the step in bits/s, only valid for STEP */
+    bool is_load_step;  /**< the STEP report covers a load level instead of a bandwidth ramp step */
+    uint8_t step_load_percent;  /**< load steps: duty cycle of the load during the step, only valid for STEP */
+    uint32_t period_corrupt_bytes;  /**< verify mode server: received bytes not matching the pattern within this period */
+    uint32_t period_corrupt_segments;  /**< verify mode server: receives (UDP: datagrams) with corrupted bytes within this period */
+    uint64_t total_verified_bytes;  /**< verify mode server: bytes checked against the pattern since iperf has started */
+    uint64_t total_corrupt_bytes;  /**< verify mode server: corrupted bytes since iperf has started */
+    uint32_t total_corrupt_segments;  /**< verify mode server: corrupted receives (UDP: datagrams) since iperf has started */
+    iperf_file_stats_t file_stats;  /**< client with a payload file or server writing to a file: file statistics, only valid for SUMMARY */
+    iperf_isoch_stats_t isoch;  /**< isochronous traffic: frame statistics, only valid for SUMMARY */
+    iperf_trace_stats_t trace;  /**< trace replay client: timing statistics, only valid for SUMMARY */
+    iperf_load_stats_t load;  /**< instance with a load co-runner: load statistics, only valid for SUMMARY */
+    uint32_t period_failed_sends;  /**< UDP client: sends failed for lack of buffers (ENOMEM, ENOBUFS) within this period */
+    uint32_t total_failed_sends;  /**< UDP client: sends failed for lack of buffers since iperf has started */
+    uint64_t period_failed_bytes;  /**< UDP client: bytes of the failed sends within this period, offered bytes are period_bytes plus these */
+    uint64_t total_failed_bytes;  /**< UDP client: bytes of the failed sends since iperf has started */
+    uint64_t backoff_us;  /**< UDP client: time spent in backoff after failed sends, only valid for SUMMARY */
+    int32_t sndbuf_len;  /**< socket_buf_len: SO_SNDBUF read back from the socket layer, 0 if not set or refused, only valid for SUMMARY */
+    int32_t rcvbuf_len;  /**< socket_buf_len: SO_RCVBUF read back from the socket layer, 0 if not set or refused, only valid for SUMMARY */
 } iperf_traffic_report_t;
 
 /**
@@ -101,6 +223,120 @@ typedef struct {
     };
 } iperf_report_t;
 
+/**
+ * @brief Stepped bandwidth ramp of a paced client
+ *
+ * The client starts at bw_lim of the configuration and adds step_bw every step_sec until max_bw is reached.
+ */
+typedef struct {
+    int32_t step_bw;  /**< bandwidth added at every step in bits/s, 0 for no ramp */
+    uint32_t step_sec;  /**< step duration in secs, rounded up to a multiple of the report interval */
+    int32_t max_bw;  /**< bandwidth of the last step in bits/s, held until the end of the test (0 for no maximum) */
+} iperf_ramp_cfg_t;
+
+/**
+ * @brief CPU and memory load run next to the traffic
+ *
+ * A load task is busy for duty_percent of every 100 ms while the test runs, to measure throughput under contention.
+ * With load steps the duty cycle starts at duty_percent and step_percent is added every step_sec, up to 100 %.
+ */
+typedef struct {
+    uint8_t duty_percent;  /**< share of the time the load task is busy, 0 for no load unless there are load steps */
+    uint8_t step_percent;  /**< duty cycle added at every load step, 0 for a constant load */
+    uint32_t step_sec;  /**< load step duration in secs, rounded up to a multiple of the report interval */
+    int8_t core;  /**< core the load task is pinned to, -1 for any core */
+    uint8_t priority;  /**< load task priority, 0 for the traffic task priority */
+    uint32_t mem_len;  /**< bytes of a buffer (in PSRAM if available) the load copies through, 0 to only spin */
+} iperf_load_cfg_t;
+
+/**
+ * @brief Isochronous traffic of a UDP client
+ *
+ * fps frames per second are sent, each as a burst of datagrams. Frame sizes follow a normal distribution given as
+ * bandwidth, a frame carries mean_bw / 8 / fps bytes on average.
+ */
+typedef struct {
+    uint32_t fps;  /**< frames per second, 0 for no isochronous traffic */
+    int32_t mean_bw;  /**< mean bandwidth in bits/s */
+    int32_t stdev_bw;  /**< standard deviation of the bandwidth in bits/s, 0 for frames of the same size */
+} iperf_isoch_cfg_t;
+
+/**
+ * @brief What a UDP client does after a send failed for lack of buffers (ENOMEM, ENOBUFS)
+ *
+ * Retrying at once keeps the core busy while the stack is out of buffers, which can starve the tasks freeing them.
+ */
+typedef enum {
+    IPERF_BACKOFF_NONE = 0,  /**< retry at once */
+    IPERF_BACKOFF_YIELD,  /**< yield to other ready tasks of the same priority before the next send */
+    IPERF_BACKOFF_DELAY,  /**< sleep for a delay doubled by every failure in a row, from a tick up to max_delay_ms */
+    IPERF_BACKOFF_SELECT,  /**< wait until the socket is writable, at most the delay of IPERF_BACKOFF_DELAY. lwIP reports UDP sockets writable without free buffers, a tick is slept then */
+} iperf_backoff_policy_t;
+
+/**
+ * @brief Backoff of a UDP client after sends failed for lack of buffers
+ */
+typedef struct {
+    iperf_backoff_policy_t policy;  /**< backoff policy */
+    uint16_t max_delay_ms;  /**< longest delay of IPERF_BACKOFF_DELAY and IPERF_BACKOFF_SELECT, 0 for the default */
+} iperf_backoff_cfg_t;
+
+/**
+ * @brief Arrival process of a traffic model
+ */
+typedef enum {
+    IPERF_ARRIVAL_CONSTANT = 0,  /**< datagrams are spaced evenly for the bandwidth limit */
+    IPERF_ARRIVAL_POISSON,  /**< exponentially distributed gaps, the mean gap gives the bandwidth limit */
+    IPERF_ARRIVAL_ON_OFF,  /**< bursts alternate with pauses, both of exponentially distributed length. Bursts are sent at the peak rate that averages the bandwidth limit */
+} iperf_arrival_t;
+
+#define IPERF_IMIX_MAX_LENS     8  /**< maximum number of datagram lengths of a mix */
+
+/**
+ * @brief Datagram length of a mix and its weight
+ */
+typedef struct {
+    uint16_t len;  /**< datagram length in bytes, at most len_send_buf */
+    uint16_t weight;  /**< relative frequency of the length, 0 ends the mix */
+} iperf_imix_entry_t;
+
+/**
+ * @brief Synthetic traffic model of a UDP client
+ *
+ * Every datagram is scheduled by the arrival process, its length is drawn from the mix. Both are driven by a
+ * pseudo-random generator, the same seed gives the same traffic.
+ */
+typedef struct {
+    iperf_arrival_t arrival;  /**< arrival process, other than IPERF_ARRIVAL_CONSTANT it needs a bandwidth limit */
+    uint32_t on_ms;  /**< IPERF_ARRIVAL_ON_OFF: mean burst length in ms */
+    uint32_t off_ms;  /**< IPERF_ARRIVAL_ON_OFF: mean pause length in ms */
+    iperf_imix_entry_t imix[IPERF_IMIX_MAX_LENS];  /**< datagram length mix, all datagrams are len_send_buf long if the first weight is 0 */
+    uint32_t seed;  /**< seed of the pseudo-random generator, 0 to derive it from the instance id */
+} iperf_traffic_model_t;
+
+#define IPERF_TRACE_MAGIC       0x49505452  /**< "IPTR", first field of a trace file */
+
+/**
+ * @brief Trace file of a replaying UDP client
+ *
+ * The file is this header followed by `records` iperf_trace_record_t, all fields in network byte order. Send times
+ * do not decrease, the first record is sent at the start of the test. A trace can be converted from a capture, e.g.
+ * from the frame.time_relative and udp.length fields exported by tshark.
+ */
+typedef struct {
+    uint32_t magic;  /**< IPERF_TRACE_MAGIC */
+    uint32_t records;  /**< number of records following the header */
+} iperf_trace_file_hdr_t;
+
+/**
+ * @brief Datagram of a trace file
+ */
+typedef struct {
+    uint32_t offset_us;  /**< send time from the start of the trace in us */
+    uint16_t len;  /**< datagram length in bytes, limited to len_send_buf when replayed */
+    uint16_t reserved;  /**< 0 */
+} iperf_trace_record_t;
+
 /**
  * @brief Structure of data for iperf state handler
  */
@@ -129,10 +365,24 @@ typedef void (*iperf_state_handler_func_t)(iperf_id_t instance_id, iperf_state_d
      int32_t bw_lim;  /**< bandwidth limit in bits/s */
      uint16_t dport;  /**< destination port */
      uint16_t sport;  /**< source port */
-     uint16_t len_send_buf;  /**< send buffer length in bytes */
+     uint32_t len_send_buf;  /**< send buffer length in bytes, UDP datagrams and requests are limited to 64 KB */
+     uint16_t iov_count;  /**< TCP client: sends are gathered from this many iovecs of len_send_buf / iov_count bytes, 0 or 1 for one contiguous buffer */
      int tos;  /**< set socket TOS field */
+     uint32_t socket_buf_len;  /**< socket send and receive buffer sizes in bytes (SO_SNDBUF, SO_RCVBUF), 0 for the socket layer defaults */
+     uint16_t mss;  /**< TCP maximum segment size in bytes (TCP_MAXSEG), 0 for the socket layer default */
      uint8_t traffic_task_priority;  /**< iperf traffic task priority */
      iperf_id_t instance_id;  /**< iperf instance id */
+     iperf_transport_type_t transport;  /**< transport carrying the traffic, IPERF_TRANSPORT_SOCKET by default */
+     uint16_t rr_response_len;  /**< IPERF_FLAG_RR client: response length in bytes, 0 for the request length (len_send_buf) */
+     iperf_ramp_cfg_t ramp;  /**< paced client: bandwidth steps starting at bw_lim, every step is reported separately */
+     const char *file_path;  /**< client: send the content of this file instead of a zero filled buffer, NULL for none */
+     const char *write_path;  /**< server: write received data to this file (the clients of a daemon one after another), NULL for none */
+     iperf_isoch_cfg_t isoch;  /**< UDP client: send frames instead of a constant rate, bw_lim is not used */
+     iperf_traffic_model_t model;  /**< UDP client: arrival process and datagram length mix, constant rate and length if all zero */
+     const char *trace_path;  /**< UDP client: replay the send times and datagram lengths of this trace file (see iperf_trace_record_t) instead of bw_lim, NULL for none */
+     bool trace_loop;  /**< UDP client: start the trace over at its end until the test ends, else the test ends with the trace */
+     iperf_load_cfg_t load;  /**< load task run next to the traffic, to report throughput under CPU or memory contention */
+     iperf_backoff_cfg_t backoff;  /**< UDP client: backoff after sends failed for lack of buffers, retry at once by default */
  } iperf_cfg_t;
 
 
@@ -1,14 +1,18 @@
 /*
- * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2024-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <sys/socket.h>
 #include <stdatomic.h>
 #include <sys/queue.h>
+#include <sys/param.h>
 #include <inttypes.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
@@ -16,7 +20,6 @@
 #include "iperf.h"
 #include "iperf_private.h"
 
-
 static const char *TAG = "iperf";
 
 #ifdef CONFIG_FREERTOS_NUMBER_OF_CORES
@@ -30,6 +33,11 @@ static const char *TAG = "iperf";
 #define IPERF_TIME_FORCE_ELAPSED            (0)
 #define IPERF_TASKS_FINISH_TMO_MS           (1500)
 #define IPERF_LIST_LOCK_TMO_RTOS_TICKS      portMAX_DELAY
+#define IPERF_UDP_FIN_RETRIES               (10)
+#define IPERF_UDP_FIN_TIMEOUT_MS            (100)
+#define IPERF_RR_UDP_RESPONSE_TMO_MS        (500)
+#define IPERF_ACCEPT_POLL_MS                (100)
+#define IPERF_SESSION_REPORT_TMO_MS         (1000)
 
 #define TAG_ID iperf_instance->tag
 
@@ -45,6 +53,11 @@ static SemaphoreHandle_t s_list_lock = NULL;
 static esp_err_t iperf_stop_exec(iperf_instance_data_t *iperf_instance);
 static void iperf_delete_instance(iperf_instance_data_t *iperf_instance);
 static iperf_traffic_type_t iperf_get_traffic_type_internal(iperf_instance_data_t *iperf_instance);
+static const iperf_transport_t iperf_transport_socket;
+
+/* client or server traffic loop variant, see iperf_get_traffic_loop() */
+typedef esp_err_t (*iperf_traffic_loop_t)(iperf_instance_data_t *iperf_instance);
+
 extern void iperf_report_task(void *arg);
 
 
@@ -112,7 +125,7 @@ static esp_err_t iperf_create_timers(iperf_instance_data_t *iperf_instance)
     };
     ESP_RETURN_ON_ERROR(esp_timer_create(&tick_timer_args, &(iperf_instance->timers.tick_timer)), TAG_ID, "failed to create tick timer");
 
-    if (iperf_instance->timers.tx_period_us > 0) {
+    if (iperf_instance->timers.tx_period_us > 0 || iperf_instance->timers.tx_oneshot) {
         esp_timer_create_args_t tx_timer_args = {
             .callback = &tx_timer_cb,
             .arg = iperf_instance,
@@ -126,7 +139,7 @@ static esp_err_t iperf_create_timers(iperf_instance_data_t *iperf_instance)
 
 static esp_err_t iperf_start_timers(iperf_instance_data_t *iperf_instance)
 {
-    if (iperf_instance->timers.tx_timer) {
+    if (iperf_instance->timers.tx_timer && !iperf_instance->timers.tx_oneshot) {
         ESP_RETURN_ON_ERROR(esp_timer_start_periodic(iperf_instance->timers.tx_timer, iperf_instance->timers.tx_period_us),
                             TAG_ID, "failed to start Tx timer");
     }
@@ -149,9 +162,13 @@ static esp_err_t iperf_delete_timers(iperf_instance_data_t *iperf_instance)
 {
     esp_err_t ret;
     if (iperf_instance->timers.tx_timer) {
+        // the Tx timer may have been restarted by iperf_set_bandwidth() while the instance stopped
+        esp_timer_stop(iperf_instance->timers.tx_timer);
         ret = esp_timer_delete(iperf_instance->timers.tx_timer);
+        iperf_instance->timers.tx_timer = NULL;
     }
     ret = esp_timer_delete(iperf_instance->timers.tick_timer);
+    iperf_instance->timers.tick_timer = NULL;
     return ret;
 }
 
@@ -185,199 +202,1712 @@ inline static bool iperf_is_tcp_server(iperf_instance_data_t *iperf_instance)
     return ((iperf_instance->flags & IPERF_FLAG_SERVER) && (iperf_instance->flags & IPERF_FLAG_TCP));
 }
 
-IRAM_ATTR static esp_err_t iperf_client_loop(iperf_instance_data_t *iperf_instance)
+/* CPU time consumed by the calling task in microseconds, 0 if the platform cannot measure it */
+static uint64_t iperf_get_task_cpu_time_us(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    // FreeRTOS tasks are backed by POSIX threads on linux target
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000 * 1000 + ts.tv_nsec / 1000;
+    }
+    return 0;
+#elif CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER
+    // run time counter is clocked by esp_timer, hence in microseconds
+    TaskStatus_t task_status;
+    vTaskGetInfo(NULL, &task_status, pdFALSE, eRunning);
+    return task_status.ulRunTimeCounter;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * UDP client: a send failed for lack of buffers (ENOMEM, ENOBUFS). It is counted, then the client backs off as
+ * configured so that the tasks freeing the buffers can run, instead of retrying at once.
+ */
+static void iperf_send_backoff(iperf_instance_data_t *iperf_instance, uint32_t len)
+{
+    iperf_backoff_t *backoff = &iperf_instance->backoff;
+
+    atomic_fetch_add(&backoff->failed_sends, 1);
+    atomic_fetch_add(&backoff->failed_bytes, len);
+    if (backoff->cfg.policy == IPERF_BACKOFF_NONE) {
+        return;
+    }
+    uint32_t delay_ms = backoff->delay_ms ? backoff->delay_ms : 1;
+    backoff->delay_ms = MIN(delay_ms * 2, backoff->cfg.max_delay_ms);
+    int64_t start_us = esp_timer_get_time();
+    switch (backoff->cfg.policy) {
+    case IPERF_BACKOFF_YIELD:
+        taskYIELD();
+        break;
+    case IPERF_BACKOFF_SELECT:
+        if (!iperf_instance->transport->wait_writable(iperf_instance, delay_ms) ||
+                esp_timer_get_time() - start_us >= portTICK_PERIOD_MS * 1000) {
+            break;
+        }
+        // writable at once: lwIP reports UDP sockets writable without free buffers, wait a tick instead
+        vTaskDelay(1);
+        break;
+    case IPERF_BACKOFF_DELAY:
+        vTaskDelay(MAX(pdMS_TO_TICKS(delay_ms), 1));
+        break;
+    default:
+        break;
+    }
+    atomic_fetch_add(&backoff->wait_us, esp_timer_get_time() - start_us);
+}
+
+/* send accounting of a client run, shared by the iperf_client_loop() variants */
+typedef struct {
+    bool is_started;
+    uint64_t cpu_time_start;
+} iperf_client_tx_t;
+
+/*
+ * Accounts a send call of every iperf_client_loop() variant, which only builds the payload and keeps its schedule:
+ * `actual` bytes were sent, less than `want` failed. The first send of data starts the test.
+ * Only UDP send errors caused by lack of memory are tolerated, they are backed off. Other errors are logged and end the
+ * test with ESP_FAIL.
+ */
+__attribute__((always_inline))
+static inline esp_err_t iperf_client_sent(iperf_instance_data_t *iperf_instance, iperf_client_tx_t *tx, int actual, int want, const bool is_udp)
+{
+    iperf_instance->transport_stats.send_calls++;
+    if (unlikely(actual < want)) {
+        if (!iperf_instance->is_running) {
+            // the test was stopped during the send
+            return ESP_OK;
+        }
+        iperf_instance->transport_stats.errors++;
+        // ENOMEM & ENOBUFS is expected for UDP under heavy load => do not print it
+        if (!is_udp || ((errno != ENOMEM) && (errno != ENOBUFS))) {
+            iperf_show_socket_error_reason(iperf_instance, "send");
+            return ESP_FAIL;
+        }
+        iperf_send_backoff(iperf_instance, want);
+        return ESP_OK;
+    }
+    if (is_udp) {
+        iperf_instance->backoff.delay_ms = 0;
+    }
+    if (actual <= 0) {
+        return ESP_OK;
+    }
+    atomic_fetch_add(&(iperf_instance->period_data_passed), actual);
+    if (unlikely(!tx->is_started)) {
+        tx->cpu_time_start = iperf_get_task_cpu_time_us();
+        iperf_state_action(IPERF_STARTED, iperf_instance);
+        tx->is_started = true;
+    }
+    return ESP_OK;
+}
+
+/* ends the send accounting of a client run, the test stops if it was started */
+static inline void iperf_client_tx_end(iperf_instance_data_t *iperf_instance, const iperf_client_tx_t *tx)
+{
+    if (tx->is_started) {
+        iperf_instance->cpu_time_us = iperf_get_task_cpu_time_us() - tx->cpu_time_start;
+        iperf_state_action(IPERF_STOPPED, iperf_instance);
+    }
+}
+
+/*
+ * Traffic loop bodies are specialized at compile time: the parameters are constants in every caller, so the per packet
+ * protocol, pacing and stamping checks are folded away and each variant is a straight loop.
+ * - is_udp: only UDP send errors caused by lack of memory are tolerated
+ * - is_paced: every send waits for a credit of the Tx timer
+ * - is_stamped: datagrams are sequentially numbered, TCP streams carry no sequence numbers
+ */
+__attribute__((always_inline))
+static inline esp_err_t iperf_client_loop_impl(iperf_instance_data_t *iperf_instance, const bool is_udp, const bool is_paced, const bool is_stamped)
 {
     esp_err_t ret = ESP_OK;
-    socklen_t addr_len = sizeof(struct sockaddr);
+    const iperf_transport_t *transport = iperf_instance->transport;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
     uint32_t pkt_cnt = 0;
-    const char* error_log = "sendto";
     int want_send = iperf_instance->socket_info.buffer_len;
-    uint32_t* pkt_id_p = (uint32_t *) iperf_instance->socket_info.buffer;
-    bool is_started = false;
+    uint32_t pkt_id;
+    iperf_client_tx_t tx = { 0 };
+    // verify mode: TCP data continues the pattern where the previous send ended, the buffer holds one extra period
+    const bool is_verify_stream = !is_udp && (iperf_instance->flags & IPERF_FLAG_VERIFY);
+    uint32_t verify_offset = iperf_instance->verify.offset;
+
+    while (true) {
+        // we don't clear count on exit so if Tx was delayed by printing report, we execute with shorter period next time and so
+        // can catch up the delay
+        if (is_paced && ulTaskNotifyTake(pdFALSE, portMAX_DELAY) == 0) {
+            break;
+        }
+        if (!iperf_instance->is_running) {
+            break;
+        }
+        if (is_stamped) {
+            // datagrams need to be sequentially numbered
+            pkt_id = htonl(pkt_cnt++);
+            memcpy(buffer, &pkt_id, sizeof(pkt_id));
+        }
+        int actual_send = transport->send(iperf_instance, is_verify_stream ? buffer + verify_offset : buffer, want_send);
+        ret = iperf_client_sent(iperf_instance, &tx, actual_send, want_send, is_udp);
+        if (unlikely(ret != ESP_OK)) {
+            break;
+        }
+        if (is_verify_stream && actual_send > 0) {
+            verify_offset = (verify_offset + actual_send) % IPERF_VERIFY_PERIOD;
+        }
+    }
+    if (is_stamped) {
+        iperf_instance->udp_tx_datagrams = pkt_cnt;
+    }
+    iperf_instance->verify.offset = verify_offset;
+    iperf_client_tx_end(iperf_instance, &tx);
+    return ret;
+}
+
+#define IPERF_CLIENT_LOOP_VARIANT(name, is_udp, is_paced, is_stamped) \
+    IRAM_ATTR static esp_err_t name(iperf_instance_data_t *iperf_instance) \
+    { \
+        return iperf_client_loop_impl(iperf_instance, is_udp, is_paced, is_stamped); \
+    }
+
+IPERF_CLIENT_LOOP_VARIANT(iperf_client_loop_udp_paced, true, true, true)
+IPERF_CLIENT_LOOP_VARIANT(iperf_client_loop_udp, true, false, true)
+IPERF_CLIENT_LOOP_VARIANT(iperf_client_loop_tcp_paced, false, true, false)
+IPERF_CLIENT_LOOP_VARIANT(iperf_client_loop_tcp, false, false, false)
+
+/*
+ * iperf_client_loop() variant of TCP clients with gathered sends: one send call takes socket_info.buffer_len bytes
+ * from iov_count iovecs, which all reference the same buffer of buffer_len / iov_count bytes. Long writes cost fewer
+ * calls without a contiguous buffer of their length.
+ */
+static esp_err_t iperf_client_loop_iov(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    const bool is_paced = iperf_instance->timers.tx_timer != NULL;
+    const uint32_t want_send = iperf_instance->socket_info.buffer_len;
+    const int iov_count = iperf_instance->socket_info.iov_count;
+    const uint32_t iov_len = (want_send + iov_count - 1) / iov_count;
+    struct iovec *iov = calloc(iov_count, sizeof(struct iovec));
+    iperf_client_tx_t tx = { 0 };
+
+    ESP_RETURN_ON_FALSE(iov, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for iovecs");
+    for (int i = 0; i < iov_count; i++) {
+        iov[i].iov_base = iperf_instance->socket_info.buffer;
+        iov[i].iov_len = i * iov_len < want_send ? MIN(iov_len, want_send - i * iov_len) : 0;
+    }
+    while (true) {
+        if (is_paced && ulTaskNotifyTake(pdFALSE, portMAX_DELAY) == 0) {
+            break;
+        }
+        if (!iperf_instance->is_running) {
+            break;
+        }
+        int actual_send = transport->send_iov(iperf_instance, iov, iov_count);
+        // a partial send is counted as it is and its unsent tail is dropped, the next send starts over with the whole buffer
+        ret = iperf_client_sent(iperf_instance, &tx, actual_send, 0, false);
+        if (unlikely(ret != ESP_OK)) {
+            break;
+        }
+    }
+    iperf_client_tx_end(iperf_instance, &tx);
+    free(iov);
+    return ret;
+}
+
+/*
+ * iperf_client_loop() variant sending the payload file, see iperf_file.c.
+ * TCP data is sent from the file source as it is, UDP datagrams are copied into the instance buffer to be numbered.
+ * The time waiting for file data and the time in send calls are accounted to find the bottleneck.
+ */
+static esp_err_t iperf_client_loop_file(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    const bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    const bool is_paced = iperf_instance->timers.tx_timer != NULL;
+    iperf_file_stats_t *stats = &iperf_instance->file_stats;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    uint32_t want_send = iperf_instance->socket_info.buffer_len;
+    uint32_t pkt_cnt = 0;
+    uint32_t pkt_id;
+    iperf_client_tx_t tx = { 0 };
 
-    // we don't clear count on exit so if Tx was delayed by printing report, we execute with shorter period next time and so
-    // can catch up the delay
-    while (iperf_instance->timers.tx_timer == NULL || ulTaskNotifyTake(pdFALSE, portMAX_DELAY) > 0) {
+    ESP_RETURN_ON_ERROR(iperf_file_open(iperf_instance, want_send), TAG_ID, "cannot start client: payload file is not available");
+    while (true) {
+        if (is_paced && ulTaskNotifyTake(pdFALSE, portMAX_DELAY) == 0) {
+            break;
+        }
         if (!iperf_instance->is_running) {
             break;
         }
-        *pkt_id_p = htonl(pkt_cnt++); // datagrams need to be sequentially numbered
-        int actual_send = sendto(iperf_instance->socket, iperf_instance->socket_info.buffer, want_send,
-                                 0, (struct sockaddr *) &iperf_instance->socket_info.target_addr, addr_len);
-        if (actual_send != want_send && iperf_instance->is_running) {
-            if (iperf_instance->flags & IPERF_FLAG_UDP) {
-                // ENOMEM & ENOBUFS is expected under heavy load => do not print it
-                if ((errno != ENOMEM) && (errno != ENOBUFS)) {
-                    iperf_show_socket_error_reason(iperf_instance, error_log);
-                    ret = ESP_FAIL;
-                    goto err;
+        const uint8_t *data = NULL;
+        uint32_t len = 0;
+        int64_t start_us = esp_timer_get_time();
+        if (is_udp) {
+            data = buffer;
+            for (uint32_t filled = 0; filled < want_send; filled += len) {
+                const uint8_t *chunk = iperf_file_next(iperf_instance, want_send - filled, &len);
+                if (chunk == NULL) {
+                    data = NULL;
+                    break;
                 }
-            } else if (iperf_instance->flags & IPERF_FLAG_TCP) {
-                iperf_show_socket_error_reason(iperf_instance, error_log);
-                ret = ESP_FAIL;
-                goto err;
+                memcpy(buffer + filled, chunk, len);
+                iperf_file_release(iperf_instance, len);
+            }
+            pkt_id = htonl(pkt_cnt++);
+            memcpy(buffer, &pkt_id, sizeof(pkt_id));
+            if (want_send >= sizeof(iperf_udp_datagram_hdr_t)) {
+                // the server would take file data in the send time fields for time stamps
+                memset(buffer + sizeof(pkt_id), 0, 2 * sizeof(uint32_t));
             }
+            len = want_send;
         } else {
-            atomic_fetch_add(&(iperf_instance->period_data_passed), actual_send);
-            if (!is_started) {
-                iperf_state_action(IPERF_STARTED, iperf_instance);
-                is_started = true;
+            data = iperf_file_next(iperf_instance, want_send, &len);
+        }
+        int64_t read_us = esp_timer_get_time();
+        stats->file_wait_us += read_us - start_us;
+        if (data == NULL) {
+            if (iperf_instance->is_running) {
+                ESP_LOGE(TAG_ID, "payload file cannot be read");
+                ret = ESP_FAIL;
             }
+            break;
         }
-    };
-err:
-    if (is_started) {
-        iperf_state_action(IPERF_STOPPED, iperf_instance);
+        stats->read_bytes += len;
+
+        int actual_send = transport->send(iperf_instance, data, len);
+        stats->send_us += esp_timer_get_time() - read_us;
+        if (!is_udp) {
+            iperf_file_release(iperf_instance, len);
+        }
+        ret = iperf_client_sent(iperf_instance, &tx, actual_send, len, is_udp);
+        if (unlikely(ret != ESP_OK)) {
+            break;
+        }
+    }
+    if (is_udp) {
+        iperf_instance->udp_tx_datagrams = pkt_cnt;
     }
+    iperf_file_close(iperf_instance);
+    iperf_client_tx_end(iperf_instance, &tx);
     return ret;
 }
 
-IRAM_ATTR static esp_err_t iperf_server_loop(iperf_instance_data_t *iperf_instance)
+/* xorshift32, fast and reproducible from its seed. The state must not be 0 */
+static inline uint32_t iperf_prng_next(uint32_t *state)
 {
-    esp_err_t ret = ESP_OK;
-    int want_recv = iperf_instance->socket_info.buffer_len;
-    int actual_recv = 0;
-    bool is_started = false;
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
 
-#if IPERF_IPV6_ENABLED && IPERF_IPV4_ENABLED
-    socklen_t socklen = (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
-#elif IPERF_IPV6_ENABLED
-    socklen_t socklen = sizeof(struct sockaddr_in6);
-#else
-    socklen_t socklen = sizeof(struct sockaddr_in);
-#endif
-    const char *error_log = "recvfrom";
+/* isochronous client: bytes of the next frame, the sum of 12 uniform variables less 6 approximates a normal distribution */
+static uint32_t iperf_isoch_frame_len(iperf_isoch_t *isoch)
+{
+    int64_t bw = isoch->cfg.mean_bw;
 
-    while (iperf_instance->is_running) {
-        actual_recv = recvfrom(iperf_instance->socket, iperf_instance->socket_info.buffer, want_recv, 0,
-                               (struct sockaddr *)&iperf_instance->socket_info.target_addr, &socklen);
+    if (isoch->cfg.stdev_bw > 0) {
+        int64_t sum = 0;  // in units of 1/65536
+        for (int i = 0; i < 12; i++) {
+            sum += iperf_prng_next(&isoch->prng) >> 16;
+        }
+        bw += ((sum - 6 * 65536) * isoch->cfg.stdev_bw) / 65536;
+    }
+    return bw > 0 ? bw / 8 / isoch->cfg.fps : 0;
+}
 
-        if (actual_recv == -1 && iperf_instance->is_running) {
-            iperf_show_socket_error_reason(iperf_instance, error_log);
-            ret = ESP_FAIL;
-            goto err;
+/*
+ * iperf_client_loop() variant of an isochronous UDP client: a frame is sent as a burst of datagrams every Tx timer period.
+ * Every datagram carries the frame start time and iperf_isoch_hdr_t, so that the server can reassemble frames.
+ */
+static esp_err_t iperf_client_loop_isoch(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    iperf_isoch_t *isoch = &iperf_instance->isoch;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    uint32_t max_len = iperf_instance->socket_info.buffer_len;
+    iperf_udp_datagram_hdr_t hdr = { 0 };
+    iperf_isoch_hdr_t isoch_hdr = {
+        .magic = htonl(IPERF_ISOCH_MAGIC),
+        .fps = htonl(isoch->cfg.fps),
+    };
+    uint32_t pkt_cnt = 0;
+    uint32_t frame_id = 0;
+    iperf_client_tx_t tx = { 0 };
+    struct timeval now;
+
+    isoch->stats.is_sent = true;
+    while (true) {
+        uint32_t due = ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        if (due == 0 || !iperf_instance->is_running) {
+            break;
         }
-        atomic_fetch_add(&(iperf_instance->period_data_passed), actual_recv);
-        if (!is_started) {
-            ESP_RETURN_ON_ERROR(iperf_start_timers(iperf_instance), TAG_ID, "failed to start internal timers");
-            iperf_state_action(IPERF_STARTED, iperf_instance);
-            is_started = true;
+        if (due > 1) {
+            isoch->stats.slipped_frames++;
+        }
+        // the last datagram holds at least the headers, so the frame may grow a little
+        uint32_t frame_len = MAX(iperf_isoch_frame_len(isoch), IPERF_ISOCH_HDR_LEN);
+        uint32_t datagrams = (frame_len + max_len - 1) / max_len;
+        uint32_t last_len = frame_len - (datagrams - 1) * max_len;
+        if (last_len < IPERF_ISOCH_HDR_LEN) {
+            frame_len += IPERF_ISOCH_HDR_LEN - last_len;
+            last_len = IPERF_ISOCH_HDR_LEN;
+        }
+        gettimeofday(&now, NULL);
+        hdr.tv_sec = htonl(now.tv_sec);
+        hdr.tv_usec = htonl(now.tv_usec);
+        isoch_hdr.frame_id = htonl(++frame_id);
+        isoch_hdr.frame_len = htonl(frame_len);
+        memcpy(buffer + sizeof(hdr), &isoch_hdr, sizeof(isoch_hdr));
+        for (uint32_t i = 0; i < datagrams && iperf_instance->is_running; i++) {
+            int len = (i + 1 == datagrams) ? last_len : max_len;
+            hdr.id = htonl(pkt_cnt++);
+            memcpy(buffer, &hdr, sizeof(hdr));
+            int actual_send = transport->send(iperf_instance, buffer, len);
+            ret = iperf_client_sent(iperf_instance, &tx, actual_send, len, true);
+            if (unlikely(ret != ESP_OK)) {
+                goto err;
+            }
         }
+        isoch->stats.frames++;
     }
 err:
-    if (is_started) {
-        iperf_state_action(IPERF_STOPPED, iperf_instance);
-    }
+    iperf_instance->udp_tx_datagrams = pkt_cnt;
+    iperf_client_tx_end(iperf_instance, &tx);
     return ret;
 }
 
-static esp_err_t iperf_start_and_run_tcp_server(iperf_instance_data_t *iperf_instance)
+/*
+ * -ln(u) of a uniform u in (0, 1], an exponentially distributed variable of mean 1 in units of 1/65536.
+ * log2(u) comes from the position of the leading bit and a quadratic fit of the fraction (within 0.002), no libm.
+ */
+static uint32_t iperf_prng_exp_q16(uint32_t *state)
 {
-    int listen_socket = -1;
-    int opt = 1;
-    esp_err_t ret = ESP_OK;
-    struct timeval timeout = { 0 };
-    socklen_t addr_len = sizeof(struct sockaddr);
-    struct sockaddr_storage listen_addr = { 0 };
-#if IPERF_IPV4_ENABLED
-    struct sockaddr_in listen_addr4 = { 0 };
-    struct sockaddr_in remote_addr = { 0 };
-#endif
-#if IPERF_IPV6_ENABLED
-    struct sockaddr_in6 listen_addr6 = { 0 };
-    struct sockaddr_in6 remote_addr6 = { 0 };
-#endif
-    if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) {
-#if IPERF_IPV6_ENABLED
-        memcpy(&listen_addr6.sin6_addr, iperf_instance->socket_info.source.u_addr.ip6.addr, sizeof(listen_addr6.sin6_addr));
-        listen_addr6.sin6_family = AF_INET6;
-        listen_addr6.sin6_port = htons(iperf_instance->socket_info.sport);
-
-        listen_socket = socket(AF_INET6, SOCK_STREAM, IPPROTO_IPV6);
-        ESP_GOTO_ON_FALSE((listen_socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: unable to create socket - errno %d", errno);
+    uint32_t u = (iperf_prng_next(state) >> 8) + 1;  // 1 .. 2^24
+    uint32_t msb = 31 - __builtin_clz(u);
+    uint32_t f = (msb >= 16 ? u >> (msb - 16) : u << (16 - msb)) & 0xFFFF;  // u / 2^msb - 1
+    // log2(1 + f) ~ f + 0.34657 f (1 - f)
+    uint32_t log2_f = f + (uint32_t)(((uint64_t)f * (65536 - f) * 22713) >> 32);
+    // -ln(u / 2^24) = ln(2) (24 - log2(u))
+    return ((uint64_t)(((24 - msb) << 16) - log2_f) * 45426) >> 16;
+}
 
-        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
-        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IPV6_V6ONLY - errno %d", errno);
+/* value * q16 / 65536, without overflow for values below 2^58 and q16 below 32 * 65536 */
+static inline uint64_t iperf_mul_q16(uint64_t value, uint32_t q16)
+{
+    return (value >> 16) * q16 + (((value & 0xFFFF) * q16) >> 16);
+}
 
-        ESP_GOTO_ON_FALSE(bind(listen_socket, (struct sockaddr *)&listen_addr6, sizeof(listen_addr6)) == 0,
-                          ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to bind - errno %d, IPPROTO: %d", errno, AF_INET6);
-        ESP_GOTO_ON_FALSE(listen(listen_socket, 0) == 0, ESP_FAIL, err, TAG_ID, "cannot start TCP server: an error occurred during listen - errno %d", errno);
+/* traffic model: length of the next datagram, drawn from the mix by weight */
+static uint32_t iperf_model_len(iperf_model_t *model, uint32_t buffer_len)
+{
+    if (model->imix_weight == 0) {
+        return buffer_len;
+    }
+    uint32_t pick = iperf_prng_next(&model->prng) % model->imix_weight;
+    for (int i = 0; i < IPERF_IMIX_MAX_LENS && model->cfg.imix[i].weight; i++) {
+        if (pick < model->cfg.imix[i].weight) {
+            return model->cfg.imix[i].len;
+        }
+        pick -= model->cfg.imix[i].weight;
+    }
+    return buffer_len;
+}
 
-        memcpy(&listen_addr, &listen_addr6, sizeof(listen_addr6));
-#else
-        ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot start TCP server: invalid address type");
-#endif
-    } else if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V4) {
-#if IPERF_IPV4_ENABLED
-        listen_addr4.sin_family = AF_INET;
-        listen_addr4.sin_port = htons(iperf_instance->socket_info.sport);
-        listen_addr4.sin_addr.s_addr = iperf_instance->socket_info.source.u_addr.ip4.addr;
+/* traffic model: time from sending a datagram of `len` bytes to the next one in ns */
+static uint64_t iperf_model_gap_ns(iperf_model_t *model, uint32_t len, int32_t bw_lim)
+{
+    if (model->cfg.arrival == IPERF_ARRIVAL_POISSON) {
+        // around the mean gap of the mix, the gap does not depend on the length of this datagram
+        uint64_t mean_ns = (uint64_t)model->mean_len * 8 * 1000 * 1000 * 1000 / bw_lim;
+        return iperf_mul_q16(mean_ns, iperf_prng_exp_q16(&model->prng));
+    }
+    uint64_t gap_ns = (uint64_t)len * 8 * 1000 * 1000 * 1000 / bw_lim;
+    if (model->cfg.arrival == IPERF_ARRIVAL_ON_OFF) {
+        // bursts are sent at the peak rate, bw_lim is the average over bursts and pauses
+        gap_ns = iperf_mul_q16(gap_ns, ((uint64_t)model->cfg.on_ms << 16) / (model->cfg.on_ms + model->cfg.off_ms));
+    }
+    return gap_ns;
+}
 
-        listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        ESP_GOTO_ON_FALSE((listen_socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: unable to create socket - errno %d", errno);
+/*
+ * iperf_client_loop() variant of a UDP client with a traffic model: datagram lengths are drawn from the mix and a paced
+ * client schedules every datagram by the arrival process, waiting for the Tx timer started once per wait.
+ * Datagrams carry their send time, so that the server measures the jitter of the arrivals.
+ */
+static esp_err_t iperf_client_loop_model(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    iperf_model_t *model = &iperf_instance->model;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    const bool is_paced = iperf_instance->timers.tx_oneshot;
+    iperf_udp_datagram_hdr_t hdr = { 0 };
+    uint32_t pkt_cnt = 0;
+    iperf_client_tx_t tx = { 0 };
+    struct timeval now;
+    int64_t next_ns = esp_timer_get_time() * 1000;
+    int64_t burst_end_ns = INT64_MAX;
 
-        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
+    if (is_paced && model->cfg.arrival == IPERF_ARRIVAL_ON_OFF) {
+        burst_end_ns = next_ns + iperf_mul_q16((uint64_t)model->cfg.on_ms * 1000 * 1000, iperf_prng_exp_q16(&model->prng));
+    }
+    while (iperf_instance->is_running) {
+        // a datagram behind its schedule is sent at once, like the paced loops catch up a delay
+        while (is_paced && iperf_instance->is_running) {
+            int64_t wait_us = next_ns / 1000 - esp_timer_get_time();
+            if (wait_us < IPERF_MODEL_MIN_WAIT_US) {
+                break;
+            }
+            // still armed after an early wakeup by a notification of the previous run
+            esp_err_t timer_ret = esp_timer_start_once(iperf_instance->timers.tx_timer, wait_us);
+            ESP_GOTO_ON_FALSE(timer_ret == ESP_OK || timer_ret == ESP_ERR_INVALID_STATE, timer_ret, err, TAG_ID, "failed to start Tx timer");
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        if (!iperf_instance->is_running) {
+            break;
+        }
+        uint32_t len = iperf_model_len(model, iperf_instance->socket_info.buffer_len);
+        gettimeofday(&now, NULL);
+        hdr.id = htonl(pkt_cnt++);
+        hdr.tv_sec = htonl(now.tv_sec);
+        hdr.tv_usec = htonl(now.tv_usec);
+        memcpy(buffer, &hdr, sizeof(hdr));
+        int actual_send = transport->send(iperf_instance, buffer, len);
+        ret = iperf_client_sent(iperf_instance, &tx, actual_send, len, true);
+        if (unlikely(ret != ESP_OK)) {
+            goto err;
+        }
+        if (is_paced) {
+            // bw_lim is read for every datagram, it follows iperf_set_tx_bandwidth()
+            next_ns += iperf_model_gap_ns(model, len, iperf_instance->bw_lim);
+            if (next_ns >= burst_end_ns) {
+                // the burst is over, the next one starts after a pause
+                next_ns = burst_end_ns + iperf_mul_q16((uint64_t)model->cfg.off_ms * 1000 * 1000, iperf_prng_exp_q16(&model->prng));
+                burst_end_ns = next_ns + iperf_mul_q16((uint64_t)model->cfg.on_ms * 1000 * 1000, iperf_prng_exp_q16(&model->prng));
+            }
+        }
+    }
+err:
+    // a later run of the instance buffer without a model must not carry stale send times
+    memset(buffer + sizeof(hdr.id), 0, sizeof(hdr.tv_sec) + sizeof(hdr.tv_usec));
+    iperf_instance->udp_tx_datagrams = pkt_cnt;
+    iperf_client_tx_end(iperf_instance, &tx);
+    return ret;
+}
 
-        ESP_GOTO_ON_FALSE(bind(listen_socket, (struct sockaddr *)&listen_addr4, sizeof(listen_addr4)) == 0,
-                          ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to bind - errno %d, IPPROTO: %d", errno, AF_INET);
+static inline void iperf_rtt_record(iperf_rtt_hist_t *hist, uint32_t rtt_us)
+{
+    uint32_t bucket = rtt_us;
+    if (rtt_us >= IPERF_RTT_HIST_SUB_BUCKETS) {
+        uint32_t shift = 31 - __builtin_clz(rtt_us) - IPERF_RTT_HIST_SUB_BITS;
+        bucket = (shift + 1) * IPERF_RTT_HIST_SUB_BUCKETS + ((rtt_us >> shift) & (IPERF_RTT_HIST_SUB_BUCKETS - 1));
+    }
+    hist->buckets[bucket]++;
+    hist->min_us = hist->count ? MIN(hist->min_us, rtt_us) : rtt_us;
+    hist->max_us = MAX(hist->max_us, rtt_us);
+    hist->sum_us += rtt_us;
+    hist->count++;
+}
 
-        ESP_GOTO_ON_FALSE(listen(listen_socket, 0) == 0, ESP_FAIL, err, TAG_ID, "cannot start TCP server: an error occurred during listen - errno %d", errno);
-        memcpy(&listen_addr, &listen_addr4, sizeof(listen_addr4));
-#else
-        ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot start TCP server: invalid address type");
-#endif
+/* middle of the range of round trip times counted in the bucket */
+static uint32_t iperf_rtt_bucket_us(uint32_t bucket)
+{
+    if (bucket < IPERF_RTT_HIST_SUB_BUCKETS) {
+        return bucket;
     }
-    ESP_LOGI(TAG_ID, "[TCP Server] Socket created");
+    uint32_t shift = bucket / IPERF_RTT_HIST_SUB_BUCKETS - 1;
+    return ((IPERF_RTT_HIST_SUB_BUCKETS + bucket % IPERF_RTT_HIST_SUB_BUCKETS) << shift) + ((1U << shift) >> 1);
+}
 
-    timeout.tv_sec = IPERF_SOCKET_ACCEPT_TIMEOUT;
-    ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
+/* min/avg/max are exact, percentiles come from the histogram */
+static void iperf_rtt_summarize(const iperf_rtt_hist_t *hist, iperf_rtt_stats_t *rtt)
+{
+    const struct {
+        uint32_t percent;
+        uint32_t *value;
+    } percentiles[] = {
+        { 50, &rtt->p50_us },
+        { 90, &rtt->p90_us },
+        { 99, &rtt->p99_us },
+    };
+    uint32_t cumulative = 0;
+    size_t i = 0;
 
-    if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) {
-#if IPERF_IPV6_ENABLED
-        iperf_instance->socket = accept(listen_socket, (struct sockaddr *)&remote_addr6, &addr_len);
-        ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to accept connection - errno %d", errno);
-        char addr_str[INET6_ADDRSTRLEN];
-        inet6_ntoa_r(remote_addr6.sin6_addr, addr_str, sizeof(addr_str));
-        ESP_LOGD(TAG_ID, "accept: [%s]:%d", addr_str, htons(remote_addr6.sin6_port));
-#endif
-    } else if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V4) {
-#if IPERF_IPV4_ENABLED
-        iperf_instance->socket = accept(listen_socket, (struct sockaddr *)&remote_addr, &addr_len);
-        ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to accept connection - errno %d, socket: %d", errno, listen_socket);
-        char addr_str[INET_ADDRSTRLEN];
-        inet_ntoa_r(remote_addr.sin_addr, addr_str, sizeof(addr_str));
-        ESP_LOGD(TAG_ID, "accept: %s:%d", addr_str, htons(remote_addr.sin_port));
-#endif
+    if (hist->count == 0) {
+        return;
     }
+    rtt->min_us = hist->min_us;
+    rtt->max_us = hist->max_us;
+    rtt->avg_us = hist->sum_us / hist->count;
+    for (uint32_t bucket = 0; bucket < IPERF_RTT_HIST_BUCKETS && i < sizeof(percentiles) / sizeof(percentiles[0]); bucket++) {
+        cumulative += hist->buckets[bucket];
+        while (i < sizeof(percentiles) / sizeof(percentiles[0]) && (uint64_t)cumulative * 100 >= (uint64_t)hist->count * percentiles[i].percent) {
+            *percentiles[i].value = MIN(MAX(iperf_rtt_bucket_us(bucket), hist->min_us), hist->max_us);
+            i++;
+        }
+    }
+}
 
-    timeout.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
-    ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
-    ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IP_TOS - errno %d", errno);
-    iperf_instance->socket_info.target_addr = listen_addr;
+/* isochronous server: frames of the current client, called for each datagram carrying data */
+static void iperf_isoch_rx(iperf_instance_data_t *iperf_instance, const uint8_t *datagram, uint32_t len)
+{
+    iperf_isoch_t *isoch = &iperf_instance->isoch;
+    iperf_udp_datagram_hdr_t hdr;
+    iperf_isoch_hdr_t isoch_hdr;
 
-    // if loop finished prematurely due to error
-    if (iperf_server_loop(iperf_instance) != ESP_OK) {
-        goto err;
+    if (len < IPERF_ISOCH_HDR_LEN) {
+        return;
     }
-    goto exit;
-err:
-    iperf_stop_exec(iperf_instance);
-exit:
-    if (iperf_instance->socket != -1) {
-        shutdown(iperf_instance->socket, 0);
-        close(iperf_instance->socket);
-        ESP_LOGD(TAG_ID, "TCP Socket server is closed.");
+    memcpy(&isoch_hdr, datagram + sizeof(hdr), sizeof(isoch_hdr));
+    if (ntohl(isoch_hdr.magic) != IPERF_ISOCH_MAGIC) {
+        return;
+    }
+    uint32_t frame_id = ntohl(isoch_hdr.frame_id);
+    if (frame_id != isoch->frame_id) {
+        if (frame_id < isoch->frame_id) {
+            // reordered datagram of a frame given up already
+            return;
+        }
+        if (isoch->frame_id != 0) {
+            // a frame is given up when the next one starts, frames in between were lost entirely
+            isoch->stats.incomplete_frames += (isoch->frame_rx < isoch->frame_len) + frame_id - isoch->frame_id - 1;
+        }
+        isoch->frame_id = frame_id;
+        isoch->frame_len = ntohl(isoch_hdr.frame_len);
+        isoch->frame_rx = 0;
+        isoch->period_us = 1000 * 1000 / MAX(ntohl(isoch_hdr.fps), 1);
+    }
+    if (isoch->frame_rx >= isoch->frame_len) {
+        // duplicate datagram of a complete frame
+        return;
+    }
+    isoch->frame_rx += len;
+    if (isoch->frame_rx >= isoch->frame_len) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        memcpy(&hdr, datagram, sizeof(hdr));
+        int64_t latency_us = ((int64_t)now.tv_sec - ntohl(hdr.tv_sec)) * 1000 * 1000 + (int64_t)now.tv_usec - ntohl(hdr.tv_usec);
+        isoch->stats.frames++;
+        if (isoch->latency_hist) {
+            // a client clock ahead of the server clock shows as zero latency
+            iperf_rtt_record(isoch->latency_hist, MIN(MAX(latency_us, 0), UINT32_MAX));
+        }
+    }
+}
+
+/* isochronous server: the first datagram of a client tells whether frames are tracked */
+static void iperf_isoch_rx_start(iperf_instance_data_t *iperf_instance, const uint8_t *datagram, uint32_t len)
+{
+    iperf_isoch_t *isoch = &iperf_instance->isoch;
+    uint32_t magic;
+
+    isoch->frame_id = 0;
+    isoch->frame_len = 0;
+    isoch->frame_rx = 0;
+    isoch->rx_active = false;
+    if (len < IPERF_ISOCH_HDR_LEN) {
+        return;
+    }
+    memcpy(&magic, datagram + sizeof(iperf_udp_datagram_hdr_t), sizeof(magic));
+    if (ntohl(magic) != IPERF_ISOCH_MAGIC) {
+        return;
+    }
+    isoch->rx_active = true;
+    if (isoch->latency_hist == NULL) {
+        isoch->latency_hist = calloc(1, sizeof(iperf_rtt_hist_t));
+        if (isoch->latency_hist == NULL) {
+            ESP_LOGW(TAG_ID, "not enough memory for frame latencies, only frames are counted");
+        }
+    }
+}
+
+/* isochronous server: latency statistics of the received frames, called by the traffic task when a client finished */
+static void iperf_isoch_summarize(iperf_instance_data_t *iperf_instance)
+{
+    iperf_isoch_t *isoch = &iperf_instance->isoch;
+    const iperf_rtt_hist_t *hist = isoch->latency_hist;
+
+    if (hist == NULL || hist->count == 0) {
+        return;
+    }
+    iperf_rtt_summarize(hist, &isoch->stats.latency);
+    // late compared with the fastest frame, at the resolution of the histogram
+    isoch->stats.late_frames = 0;
+    for (uint32_t bucket = 0; bucket < IPERF_RTT_HIST_BUCKETS; bucket++) {
+        if (hist->buckets[bucket] && iperf_rtt_bucket_us(bucket) > (uint64_t)hist->min_us + isoch->period_us) {
+            isoch->stats.late_frames += hist->buckets[bucket];
+        }
+    }
+}
+
+static void iperf_isoch_reset(iperf_instance_data_t *iperf_instance)
+{
+    iperf_isoch_t *isoch = &iperf_instance->isoch;
+
+    memset(&isoch->stats, 0, sizeof(iperf_isoch_stats_t));
+    isoch->frame_id = 0;
+    isoch->frame_len = 0;
+    isoch->frame_rx = 0;
+    if (isoch->latency_hist) {
+        memset(isoch->latency_hist, 0, sizeof(iperf_rtt_hist_t));
+    }
+}
+
+/*
+ * iperf_client_loop() variant of a UDP client replaying a trace: every record is sent at its time with its length,
+ * waiting for the Tx timer started once per wait. The deviation of the send times from the trace is recorded.
+ * Datagrams carry their send time like the ones of a traffic model.
+ */
+static esp_err_t iperf_client_loop_trace(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    iperf_trace_t *trace = &iperf_instance->trace;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    uint32_t max_len = iperf_instance->socket_info.buffer_len;
+    iperf_udp_datagram_hdr_t hdr = { 0 };
+    uint32_t pkt_cnt = 0;
+    uint32_t index = 0;
+    iperf_client_tx_t tx = { 0 };
+    struct timeval now;
+
+    ESP_RETURN_ON_ERROR(iperf_trace_open(iperf_instance), TAG_ID, "cannot start client: trace is not available");
+    int64_t start_us = esp_timer_get_time();
+    while (iperf_instance->is_running) {
+        if (index == trace->count) {
+            if (!trace->loop) {
+                ESP_LOGI(TAG_ID, "trace replayed, test ends");
+                iperf_stop_exec(iperf_instance);
+                break;
+            }
+            trace->stats.loops++;
+            start_us += trace->duration_us;
+            index = 0;
+        }
+        const iperf_trace_record_t *record = &trace->records[index++];
+        int64_t due_us = start_us + ntohl(record->offset_us) - trace->first_offset_us;
+        int64_t now_us;
+        // a datagram behind its time is sent at once, the timing error shows it
+        while ((now_us = esp_timer_get_time()) + IPERF_MODEL_MIN_WAIT_US <= due_us && iperf_instance->is_running) {
+            // still armed after an early wakeup by a notification of the previous run
+            esp_err_t timer_ret = esp_timer_start_once(iperf_instance->timers.tx_timer, due_us - now_us);
+            ESP_GOTO_ON_FALSE(timer_ret == ESP_OK || timer_ret == ESP_ERR_INVALID_STATE, timer_ret, err, TAG_ID, "failed to start Tx timer");
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        if (!iperf_instance->is_running) {
+            break;
+        }
+        if (trace->error_hist) {
+            iperf_rtt_record(trace->error_hist, MIN(now_us > due_us ? now_us - due_us : due_us - now_us, UINT32_MAX));
+        }
+        int len = MIN(MAX(ntohs(record->len), sizeof(hdr)), max_len);
+        gettimeofday(&now, NULL);
+        hdr.id = htonl(pkt_cnt++);
+        hdr.tv_sec = htonl(now.tv_sec);
+        hdr.tv_usec = htonl(now.tv_usec);
+        memcpy(buffer, &hdr, sizeof(hdr));
+        int actual_send = transport->send(iperf_instance, buffer, len);
+        ret = iperf_client_sent(iperf_instance, &tx, actual_send, len, true);
+        if (unlikely(ret != ESP_OK)) {
+            goto err;
+        }
+    }
+err:
+    // a later run of the instance buffer without a trace must not carry stale send times
+    memset(buffer + sizeof(hdr.id), 0, sizeof(hdr.tv_sec) + sizeof(hdr.tv_usec));
+    iperf_instance->udp_tx_datagrams = pkt_cnt;
+    trace->stats.datagrams = pkt_cnt;
+    if (trace->error_hist) {
+        iperf_rtt_summarize(trace->error_hist, &trace->stats.timing_error);
+        memset(trace->error_hist, 0, sizeof(iperf_rtt_hist_t));
+    }
+    iperf_trace_close(iperf_instance);
+    iperf_client_tx_end(iperf_instance, &tx);
+    return ret;
+}
+
+/* RFC 3550 interarrival jitter from the send time carried by the datagram, the clock offset of the client cancels out */
+static void iperf_udp_rx_jitter(iperf_udp_rx_stats_t *stats, const uint8_t *datagram)
+{
+    iperf_udp_datagram_hdr_t hdr;
+    struct timeval now;
+
+    memcpy(&hdr, datagram, sizeof(hdr));
+    if (hdr.tv_sec == 0 && hdr.tv_usec == 0) {
+        // the client does not stamp its datagrams
+        return;
+    }
+    gettimeofday(&now, NULL);
+    int64_t transit_us = (int64_t)(int32_t)((uint32_t)now.tv_sec - ntohl(hdr.tv_sec)) * 1000 * 1000 + (int64_t)now.tv_usec - ntohl(hdr.tv_usec);
+    if (stats->stamped++ > 0) {
+        int64_t d_us = transit_us - stats->transit_us;
+        d_us = MIN(d_us < 0 ? -d_us : d_us, UINT32_MAX >> 4);
+        // J += (|D| - J) / 16
+        uint32_t jitter_q4 = atomic_load(&stats->jitter_q4);
+        atomic_store(&stats->jitter_q4, jitter_q4 + d_us - ((jitter_q4 + 8) >> 4));
+    }
+    stats->transit_us = transit_us;
+}
+
+/* account the datagram of one UDP receive */
+static inline void iperf_udp_rx_account(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, int len)
+{
+    iperf_udp_rx_stats_t *stats = &iperf_instance->udp_rx_stats;
+    int32_t pkt_id;
+
+    if (len < (int)sizeof(pkt_id)) {
+        return;
+    }
+    memcpy(&pkt_id, buffer, sizeof(pkt_id));
+    pkt_id = ntohl(pkt_id);
+    if (unlikely(pkt_id < 0)) {
+        // iperf2 clients mark the last datagram with a negative id, every copy of it is answered with the run statistics
+        if (stats->fin_id == 0) {
+            stats->fin_id = pkt_id;
+        }
+        stats->fin_reply = true;
+        return;
+    }
+    if (unlikely(atomic_load(&stats->datagrams) == 0 || stats->fin_id != 0)) {
+        // the client may have been started earlier, count losses from the first datagram received,
+        // a datagram following a final one starts the run of the next client
+        stats->next_id = pkt_id;
+        stats->fin_id = 0;
+        stats->run_datagrams = 0;
+        stats->run_lost = 0;
+        stats->run_out_of_order = 0;
+        stats->run_bytes = 0;
+        stats->run_start_us = esp_timer_get_time();
+        atomic_store(&stats->jitter_q4, 0);
+        stats->stamped = 0;
+        iperf_isoch_rx_start(iperf_instance, buffer, len);
+    }
+    atomic_fetch_add(&stats->datagrams, 1);
+    stats->run_datagrams++;
+    stats->run_bytes += len;
+    if (unlikely(iperf_instance->isoch.rx_active)) {
+        // frame time stamps, the latency of the frames is measured instead of the jitter
+        iperf_isoch_rx(iperf_instance, buffer, len);
+    } else if (len >= (int)sizeof(iperf_udp_datagram_hdr_t)) {
+        iperf_udp_rx_jitter(stats, buffer);
+    }
+    if (pkt_id >= stats->next_id) {
+        atomic_fetch_add(&stats->lost, pkt_id - stats->next_id);
+        stats->run_lost += pkt_id - stats->next_id;
+        stats->next_id = pkt_id + 1;
+    } else {
+        // previously counted as lost
+        atomic_fetch_add(&stats->out_of_order, 1);
+        stats->run_out_of_order++;
+        if (atomic_load(&stats->lost) > 0) {
+            atomic_fetch_sub(&stats->lost, 1);
+        }
+        if (stats->run_lost > 0) {
+            stats->run_lost--;
+        }
+    }
+}
+
+/* verify mode: pattern of `len` bytes from pattern offset 0, see IPERF_VERIFY_PERIOD */
+static void iperf_verify_fill(uint8_t *buffer, uint32_t len, uint8_t seed)
+{
+    const uint8_t tag[IPERF_VERIFY_TAG_LEN] = { 0xA5, seed, (uint8_t)~seed, 0x5A };
+    uint32_t x = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t pos = i % IPERF_VERIFY_PERIOD;
+        if (pos < IPERF_VERIFY_TAG_LEN) {
+            buffer[i] = tag[pos];
+            x = seed;
+            continue;
+        }
+        // one LCG step per 4 bytes, stored most significant byte first
+        if (pos % sizeof(uint32_t) == 0) {
+            x = x * 1664525 + 1013904223;
+        }
+        buffer[i] = x >> (8 * (sizeof(uint32_t) - 1 - pos % sizeof(uint32_t)));
+    }
+}
+
+/* seed carried by a tag, -1 if the bytes are not a valid tag */
+static int16_t iperf_verify_tag_seed(const uint8_t *tag)
+{
+    if (tag[0] != 0xA5 || tag[3] != 0x5A || tag[2] != (uint8_t)~tag[1]) {
+        return -1;
+    }
+    return tag[1];
+}
+
+/* number of differing bytes, compared a word at a time */
+static uint32_t iperf_verify_count_diff(const uint8_t *data, const uint8_t *ref, uint32_t len)
+{
+    uint32_t diff = 0;
+    uint32_t i = 0;
+
+    for (; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t)) {
+        uint32_t a, b;
+        memcpy(&a, data + i, sizeof(a));
+        memcpy(&b, ref + i, sizeof(b));
+        uint32_t x = a ^ b;
+        if (x != 0) {
+            diff += ((x & 0xFF) != 0) + ((x & 0xFF00) != 0) + ((x & 0xFF0000) != 0) + ((x & 0xFF000000) != 0);
+        }
+    }
+    for (; i < len; i++) {
+        diff += data[i] != ref[i];
+    }
+    return diff;
+}
+
+/*
+ * verify mode server: check `len` received bytes continuing the pattern at `offset`.
+ * The seed is taken from the first tag received, data before it is not verified.
+ * Intact data costs one memcmp(), which the C library implements word-wide or with SIMD.
+ */
+static void iperf_verify_rx(iperf_instance_data_t *iperf_instance, const uint8_t *data, uint32_t len, uint32_t offset)
+{
+    iperf_verify_t *verify = &iperf_instance->verify;
+
+    offset %= IPERF_VERIFY_PERIOD;
+    if (unlikely(verify->seed < 0)) {
+        uint32_t tag_pos = (IPERF_VERIFY_PERIOD - offset) % IPERF_VERIFY_PERIOD;
+        if (tag_pos + IPERF_VERIFY_TAG_LEN > len || (verify->seed = iperf_verify_tag_seed(data + tag_pos)) < 0) {
+            return;
+        }
+        iperf_verify_fill(verify->ref, verify->ref_size, verify->seed);
+        ESP_LOGD(TAG_ID, "verifying stream of seed %" PRIi16, verify->seed);
+    }
+    verify->verified_bytes += len;
+    if (likely(memcmp(data, verify->ref + offset, len) == 0)) {
+        return;
+    }
+    verify->corrupt_bytes += iperf_verify_count_diff(data, verify->ref + offset, len);
+    verify->corrupt_segments++;
+}
+
+/* verify mode UDP server: check the payload of the datagram of one receive, see iperf_udp_rx_account() */
+static void iperf_verify_rx_datagram(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, int len)
+{
+    if (len > (int)IPERF_VERIFY_UDP_HDR_LEN) {
+        iperf_verify_rx(iperf_instance, buffer + IPERF_VERIFY_UDP_HDR_LEN, len - IPERF_VERIFY_UDP_HDR_LEN, 0);
+    }
+}
+
+/* answer the final datagram of a UDP client with the statistics of its run */
+static void iperf_udp_server_reply(iperf_instance_data_t *iperf_instance)
+{
+    iperf_udp_rx_stats_t *stats = &iperf_instance->udp_rx_stats;
+    struct {
+        iperf_udp_datagram_hdr_t hdr;
+        iperf_udp_server_report_t report;
+    } reply = { 0 };
+    int64_t duration_us = esp_timer_get_time() - stats->run_start_us;
+
+    stats->fin_reply = false;
+    if (iperf_instance->transport->reply == NULL) {
+        return;
+    }
+    reply.hdr.id = htonl(stats->fin_id);
+    reply.report.total_len1 = htonl(stats->run_bytes >> 32);
+    reply.report.total_len2 = htonl(stats->run_bytes & UINT32_MAX);
+    reply.report.stop_sec = htonl(duration_us / 1000000);
+    reply.report.stop_usec = htonl(duration_us % 1000000);
+    reply.report.error_cnt = htonl(stats->run_lost);
+    reply.report.outorder_cnt = htonl(stats->run_out_of_order);
+    reply.report.datagrams = htonl(stats->run_datagrams);
+    uint32_t jitter_us = atomic_load(&stats->jitter_q4) >> 4;
+    reply.report.jitter1 = htonl(jitter_us / 1000000);
+    reply.report.jitter2 = htonl(jitter_us % 1000000);
+    if (iperf_instance->transport->reply(iperf_instance, (const uint8_t *)&reply, sizeof(reply)) < 0) {
+        ESP_LOGD(TAG_ID, "failed to answer the final datagram - errno %d", errno);
+    }
+}
+
+/*
+ * daemon server: the client finished, the report task prints its summary and starts a new report.
+ * The counters restart for the next client, whose first data starts the timers again.
+ * Data since the last tick is dropped, like at the end of an instance only whole seconds are reported.
+ */
+static void iperf_daemon_end_session(iperf_instance_data_t *iperf_instance, bool *is_started, uint64_t cpu_time_start)
+{
+    if (!*is_started) {
+        return;
+    }
+    iperf_stop_timers(iperf_instance);
+    iperf_instance->cpu_time_us = iperf_get_task_cpu_time_us() - cpu_time_start;
+    iperf_isoch_summarize(iperf_instance);
+    iperf_state_action(IPERF_STOPPED, iperf_instance);
+    atomic_store(&iperf_instance->session_end, true);
+    xTaskNotifyGive(iperf_instance->report_task_hdl);
+    // the report task notifies once the summary is printed
+    TickType_t wait_start = xTaskGetTickCount();
+    while (atomic_load(&iperf_instance->session_end) && iperf_instance->is_running &&
+            xTaskGetTickCount() - wait_start < pdMS_TO_TICKS(IPERF_SESSION_REPORT_TMO_MS)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IPERF_SESSION_REPORT_TMO_MS));
+    }
+    iperf_instance->timers.ticks = 0;
+    iperf_instance->timers.to_report_ticks = 0;
+    atomic_store(&iperf_instance->period_data_passed, 0);
+    atomic_store(&iperf_instance->udp_rx_stats.datagrams, 0);
+    atomic_store(&iperf_instance->udp_rx_stats.lost, 0);
+    atomic_store(&iperf_instance->udp_rx_stats.out_of_order, 0);
+    iperf_instance->rr_transactions = 0;
+    iperf_instance->verify.seed = -1;
+    iperf_instance->verify.offset = 0;
+    iperf_instance->verify.verified_bytes = 0;
+    iperf_instance->verify.corrupt_bytes = 0;
+    iperf_instance->verify.corrupt_segments = 0;
+    memset(&iperf_instance->transport_stats, 0, sizeof(iperf_transport_stats_t));
+    iperf_isoch_reset(iperf_instance);
+    // the file is written on, only the statistics are per client
+    memset(&iperf_instance->file_stats, 0, sizeof(iperf_file_stats_t));
+    *is_started = false;
+}
+
+/* daemon TCP server: wait for the next client, fails only when the instance was stopped */
+static esp_err_t iperf_daemon_next_client(iperf_instance_data_t *iperf_instance)
+{
+    while (iperf_instance->is_running) {
+        if (iperf_instance->transport->reconnect(iperf_instance) == ESP_OK) {
+            return ESP_OK;
+        }
+        // let the stack release the failed connection before the next attempt
+        vTaskDelay(1);
+    }
+    return ESP_FAIL;
+}
+
+/* specialized like iperf_client_loop_impl(), is_udp enables datagram accounting */
+__attribute__((always_inline))
+static inline esp_err_t iperf_server_loop_impl(iperf_instance_data_t *iperf_instance, const bool is_udp)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    int want_recv = iperf_instance->socket_info.buffer_len;
+    int actual_recv = 0;
+    bool is_started = false;
+    uint64_t cpu_time_start = 0;
+    const char *error_log = "recv";
+    const bool is_daemon = iperf_instance->flags & IPERF_FLAG_DAEMON;
+    const bool is_verify = iperf_instance->flags & IPERF_FLAG_VERIFY;
+    const bool is_write = iperf_instance->write_path != NULL;
+    iperf_file_stats_t *file_stats = &iperf_instance->file_stats;
+
+    if (is_daemon && !is_udp && iperf_daemon_next_client(iperf_instance) != ESP_OK) {
+        return ESP_OK;
+    }
+    if (unlikely(is_write)) {
+        // a block holds at least one whole receive, datagrams are not split
+        uint32_t block_len = MAX(CONFIG_IPERF_FILE_WRITE_BLOCK_LEN, want_recv);
+        ESP_RETURN_ON_ERROR(iperf_file_sink_open(iperf_instance, block_len), TAG_ID, "failed to open file to write");
+    }
+    while (iperf_instance->is_running) {
+        if (likely(!is_write)) {
+            actual_recv = transport->recv(iperf_instance, buffer, want_recv);
+        } else {
+            uint32_t space = 0;
+            buffer = iperf_file_sink_buffer(iperf_instance, want_recv, &space);
+            if (buffer == NULL) {
+                // writing failed, logged by the writer
+                ret = iperf_instance->is_running ? ESP_FAIL : ESP_OK;
+                break;
+            }
+            int64_t recv_start_us = esp_timer_get_time();
+            actual_recv = transport->recv(iperf_instance, buffer, want_recv);
+            file_stats->recv_us += esp_timer_get_time() - recv_start_us;
+            if (actual_recv > 0) {
+                iperf_file_sink_commit(iperf_instance, actual_recv);
+            }
+        }
+        iperf_instance->transport_stats.recv_calls++;
+        if (unlikely(actual_recv <= 0) && is_daemon && iperf_instance->is_running) {
+            if (!is_udp) {
+                // the client closed its connection, serve the next one
+                iperf_daemon_end_session(iperf_instance, &is_started, cpu_time_start);
+                if (iperf_daemon_next_client(iperf_instance) != ESP_OK) {
+                    break;
+                }
+                continue;
+            }
+            if (actual_recv == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // nothing received within the receive timeout, the client is gone without its final datagram
+                iperf_daemon_end_session(iperf_instance, &is_started, cpu_time_start);
+                continue;
+            }
+        }
+        if (unlikely(actual_recv == -1) && iperf_instance->is_running) {
+            iperf_instance->transport_stats.errors++;
+            iperf_show_socket_error_reason(iperf_instance, error_log);
+            ret = ESP_FAIL;
+            goto err;
+        }
+        if (unlikely(is_verify) && actual_recv > 0) {
+            if (is_udp) {
+                iperf_verify_rx_datagram(iperf_instance, buffer, actual_recv);
+            } else {
+                iperf_verify_rx(iperf_instance, buffer, actual_recv, iperf_instance->verify.offset);
+                iperf_instance->verify.offset = (iperf_instance->verify.offset + actual_recv) % IPERF_VERIFY_PERIOD;
+            }
+        }
+        if (is_udp && actual_recv > 0) {
+            iperf_udp_rx_account(iperf_instance, buffer, actual_recv);
+            if (unlikely(iperf_instance->udp_rx_stats.fin_reply)) {
+                iperf_udp_server_reply(iperf_instance);
+                if (is_daemon) {
+                    // the client finished, repeated final datagrams are answered without starting a new report
+                    iperf_daemon_end_session(iperf_instance, &is_started, cpu_time_start);
+                    continue;
+                }
+            }
+        }
+        atomic_fetch_add(&(iperf_instance->period_data_passed), actual_recv);
+        if (unlikely(!is_started)) {
+            ESP_GOTO_ON_ERROR(iperf_start_timers(iperf_instance), err, TAG_ID, "failed to start internal timers");
+            cpu_time_start = iperf_get_task_cpu_time_us();
+            iperf_state_action(IPERF_STARTED, iperf_instance);
+            is_started = true;
+        }
+    }
+err:
+    if (is_write) {
+        iperf_file_sink_close(iperf_instance);
+    }
+    if (is_started) {
+        iperf_instance->cpu_time_us = iperf_get_task_cpu_time_us() - cpu_time_start;
+        iperf_state_action(IPERF_STOPPED, iperf_instance);
+    }
+    return ret;
+}
+
+IRAM_ATTR static esp_err_t iperf_server_loop_udp(iperf_instance_data_t *iperf_instance)
+{
+    return iperf_server_loop_impl(iperf_instance, true);
+}
+
+IRAM_ATTR static esp_err_t iperf_server_loop_tcp(iperf_instance_data_t *iperf_instance)
+{
+    return iperf_server_loop_impl(iperf_instance, false);
+}
+
+/* TCP connection rate: replace the connection until a new one is established or the instance is stopped */
+static void iperf_crr_reconnect(iperf_instance_data_t *iperf_instance, iperf_rtt_hist_t *connect_hist)
+{
+    while (iperf_instance->is_running) {
+        int64_t start_us = esp_timer_get_time();
+        if (iperf_instance->transport->reconnect(iperf_instance) == ESP_OK) {
+            if (connect_hist) {
+                iperf_rtt_record(connect_hist, esp_timer_get_time() - start_us);
+            }
+            iperf_instance->crr_connections++;
+            return;
+        }
+        if (!iperf_instance->is_running) {
+            return;
+        }
+        iperf_instance->crr_failures++;
+        // let the stack release the failed connection before the next attempt
+        vTaskDelay(1);
+    }
+}
+
+/*
+ * request/response client: one transaction in flight, its round trip time is recorded when the response is complete.
+ * With IPERF_FLAG_CRR every transaction uses a new connection and failed connections are counted instead of ending the test.
+ */
+static esp_err_t iperf_rr_client_loop(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    uint32_t buffer_len = iperf_instance->socket_info.buffer_len;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    bool is_crr = iperf_instance->flags & IPERF_FLAG_CRR;
+    uint16_t request_len = iperf_instance->rr_request_len;
+    uint16_t response_len = iperf_instance->rr_response_len;
+    iperf_rr_hdr_t hdr = {
+        .request_len = htons(request_len),
+        .response_len = htons(response_len),
+    };
+    uint32_t id = 0;
+    bool is_started = false;
+    uint64_t cpu_time_start = 0;
+
+    if (is_crr) {
+        // the first connection was established by the transport open
+        iperf_instance->crr_connections = 1;
+    }
+    while (iperf_instance->is_running) {
+        hdr.id = htonl(id++);
+        memcpy(buffer, &hdr, sizeof(hdr));
+        int64_t start_us = esp_timer_get_time();
+        int actual_send = transport->send(iperf_instance, buffer, request_len);
+        iperf_instance->transport_stats.send_calls++;
+        if (unlikely(actual_send != request_len)) {
+            if (!iperf_instance->is_running) {
+                break;
+            }
+            iperf_instance->transport_stats.errors++;
+            if (is_crr) {
+                iperf_instance->crr_failures++;
+                iperf_crr_reconnect(iperf_instance, iperf_instance->connect_hist);
+                continue;
+            }
+            // ENOMEM & ENOBUFS is expected for UDP under heavy load => do not print it
+            if (!is_udp || ((errno != ENOMEM) && (errno != ENOBUFS))) {
+                iperf_show_socket_error_reason(iperf_instance, "send");
+                ret = ESP_FAIL;
+                goto err;
+            }
+            continue;
+        }
+        if (unlikely(!is_started)) {
+            cpu_time_start = iperf_get_task_cpu_time_us();
+            iperf_state_action(IPERF_STARTED, iperf_instance);
+            is_started = true;
+        }
+
+        // TCP: the response may arrive in several parts, UDP: responses to earlier timed out requests are skipped
+        int received = 0;
+        while (received < response_len) {
+            int actual_recv = transport->recv(iperf_instance, buffer, is_udp ? buffer_len : MIN(buffer_len, response_len - received));
+            iperf_instance->transport_stats.recv_calls++;
+            if (unlikely(actual_recv <= 0)) {
+                if (!iperf_instance->is_running) {
+                    goto err;
+                }
+                if (is_udp && actual_recv == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    // request or response was lost
+                    iperf_instance->rtt.timeouts++;
+                    received = -1;
+                    break;
+                }
+                iperf_instance->transport_stats.errors++;
+                if (is_crr) {
+                    iperf_instance->crr_failures++;
+                    received = -1;
+                    break;
+                }
+                if (actual_recv == 0) {
+                    ESP_LOGW(TAG_ID, "the server closed the connection");
+                } else {
+                    iperf_show_socket_error_reason(iperf_instance, "recv");
+                }
+                ret = ESP_FAIL;
+                goto err;
+            }
+            if (is_udp) {
+                if (actual_recv >= sizeof(hdr) && memcmp(buffer, &hdr.id, sizeof(hdr.id)) == 0) {
+                    received = actual_recv;
+                    break;
+                }
+                continue;
+            }
+            received += actual_recv;
+        }
+        if (received >= 0) {
+            iperf_rtt_record(iperf_instance->rtt_hist, esp_timer_get_time() - start_us);
+            iperf_instance->rr_transactions++;
+            atomic_fetch_add(&(iperf_instance->period_data_passed), request_len + received);
+        }
+        if (is_crr) {
+            iperf_crr_reconnect(iperf_instance, iperf_instance->connect_hist);
+        }
+    }
+err:
+    iperf_rtt_summarize(iperf_instance->rtt_hist, &iperf_instance->rtt);
+    if (is_crr) {
+        iperf_rtt_summarize(iperf_instance->connect_hist, &iperf_instance->connect_time);
+    }
+    if (is_started) {
+        iperf_instance->cpu_time_us = iperf_get_task_cpu_time_us() - cpu_time_start;
+        iperf_state_action(IPERF_STOPPED, iperf_instance);
+    }
+    return ret;
+}
+
+/* echo server: send response_len bytes starting with the request header, in parts of the buffer length */
+static int iperf_echo_send_response(iperf_instance_data_t *iperf_instance, const iperf_rr_hdr_t *hdr, uint16_t response_len)
+{
+    const iperf_transport_t *transport = iperf_instance->transport;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    uint32_t buffer_len = iperf_instance->socket_info.buffer_len;
+    int sent = 0;
+
+    memcpy(buffer, hdr, sizeof(iperf_rr_hdr_t));
+    if (iperf_instance->flags & IPERF_FLAG_UDP) {
+        // answer the sender of the request, the response is one datagram
+        iperf_instance->transport_stats.send_calls++;
+        return transport->reply(iperf_instance, buffer, MIN(response_len, buffer_len));
+    }
+    while (sent < response_len) {
+        int actual_send = transport->send(iperf_instance, buffer, MIN(buffer_len, response_len - sent));
+        iperf_instance->transport_stats.send_calls++;
+        if (actual_send <= 0) {
+            return -1;
+        }
+        sent += actual_send;
+    }
+    return sent;
+}
+
+/* request/response server (echo role): every request is answered with the response length it asks for */
+static esp_err_t iperf_echo_server_loop(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+    uint8_t *buffer = iperf_instance->socket_info.buffer;
+    int want_recv = iperf_instance->socket_info.buffer_len;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    bool is_crr = iperf_instance->flags & IPERF_FLAG_CRR;
+    bool is_daemon = iperf_instance->flags & IPERF_FLAG_DAEMON;
+    iperf_rr_hdr_t hdr;
+    uint32_t hdr_len = 0;  /* TCP: header bytes of the current request received so far */
+    uint32_t request_left = 0;  /* TCP: bytes of the current request following its header */
+    bool is_started = false;
+    uint64_t cpu_time_start = 0;
+
+    if (is_daemon && !is_udp && iperf_daemon_next_client(iperf_instance) != ESP_OK) {
+        return ESP_OK;
+    }
+    if (is_crr) {
+        // the first connection was accepted by the transport open or by a daemon above
+        iperf_instance->crr_connections = 1;
+    }
+    while (iperf_instance->is_running) {
+        int actual_recv = transport->recv(iperf_instance, buffer, want_recv);
+        iperf_instance->transport_stats.recv_calls++;
+        if (unlikely(actual_recv == -1)) {
+            if (!iperf_instance->is_running) {
+                goto err;
+            }
+            if (is_daemon && is_udp && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // no request within the receive timeout, the client is gone
+                iperf_daemon_end_session(iperf_instance, &is_started, cpu_time_start);
+                continue;
+            }
+            iperf_instance->transport_stats.errors++;
+            if (is_udp || (!is_crr && !is_daemon)) {
+                iperf_show_socket_error_reason(iperf_instance, "recv");
+                ret = ESP_FAIL;
+                goto err;
+            }
+            iperf_instance->crr_failures++;
+        }
+        if (!is_udp && actual_recv <= 0) {
+            if (is_crr) {
+                // the client closed the connection after its transaction, wait for the next one
+                hdr_len = 0;
+                iperf_crr_reconnect(iperf_instance, NULL);
+                continue;
+            }
+            if (is_daemon) {
+                // the client closed its connection, serve the next one
+                hdr_len = 0;
+                iperf_daemon_end_session(iperf_instance, &is_started, cpu_time_start);
+                if (iperf_daemon_next_client(iperf_instance) != ESP_OK) {
+                    break;
+                }
+                continue;
+            }
+            // the client closed the connection, end the test as if its time elapsed
+            ESP_LOGD(TAG_ID, "the client closed the connection");
+            iperf_stop_exec(iperf_instance);
+            break;
+        }
+        if (unlikely(!is_started)) {
+            ESP_GOTO_ON_ERROR(iperf_start_timers(iperf_instance), err, TAG_ID, "failed to start internal timers");
+            cpu_time_start = iperf_get_task_cpu_time_us();
+            iperf_state_action(IPERF_STARTED, iperf_instance);
+            is_started = true;
+        }
+
+        uint32_t responses = 0;
+        if (is_udp) {
+            // every datagram is a request
+            if (actual_recv >= sizeof(hdr)) {
+                memcpy(&hdr, buffer, sizeof(hdr));
+                responses = 1;
+            }
+        } else {
+            for (int pos = 0; pos < actual_recv; ) {
+                if (hdr_len < sizeof(hdr)) {
+                    uint32_t len = MIN(sizeof(hdr) - hdr_len, actual_recv - pos);
+                    memcpy((uint8_t *)&hdr + hdr_len, buffer + pos, len);
+                    hdr_len += len;
+                    pos += len;
+                    if (hdr_len == sizeof(hdr)) {
+                        request_left = MAX(ntohs(hdr.request_len), sizeof(hdr)) - sizeof(hdr);
+                    }
+                } else {
+                    uint32_t len = MIN(request_left, actual_recv - pos);
+                    request_left -= len;
+                    pos += len;
+                }
+                if (hdr_len == sizeof(hdr) && request_left == 0) {
+                    // clients wait for the response before the next request, so this is the last request of the data
+                    responses++;
+                    hdr_len = 0;
+                }
+            }
+        }
+        int sent = 0;
+        for (; responses > 0; responses--) {
+            int actual_send = iperf_echo_send_response(iperf_instance, &hdr, MAX(ntohs(hdr.response_len), sizeof(hdr)));
+            if (unlikely(actual_send < 0)) {
+                if (!iperf_instance->is_running) {
+                    goto err;
+                }
+                iperf_instance->transport_stats.errors++;
+                if (is_crr) {
+                    // the client counts the failed transaction, the next one comes with a new connection
+                    iperf_instance->crr_failures++;
+                    break;
+                }
+                // the client of a lost UDP response times out and sends the next request
+                if (!is_udp || ((errno != ENOMEM) && (errno != ENOBUFS))) {
+                    iperf_show_socket_error_reason(iperf_instance, "send");
+                    ret = ESP_FAIL;
+                    goto err;
+                }
+                continue;
+            }
+            sent += actual_send;
+            iperf_instance->rr_transactions++;
+        }
+        atomic_fetch_add(&(iperf_instance->period_data_passed), actual_recv + sent);
+    }
+err:
+    if (is_started) {
+        iperf_instance->cpu_time_us = iperf_get_task_cpu_time_us() - cpu_time_start;
+        iperf_state_action(IPERF_STOPPED, iperf_instance);
+    }
+    return ret;
+}
+
+/* select the traffic loop variant once, after the transport was opened and the timers were created */
+static iperf_traffic_loop_t iperf_get_traffic_loop(iperf_instance_data_t *iperf_instance)
+{
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    bool is_paced = iperf_instance->timers.tx_timer != NULL;
+
+    if (iperf_instance->flags & IPERF_FLAG_RR) {
+        return (iperf_instance->flags & IPERF_FLAG_CLIENT) ? iperf_rr_client_loop : iperf_echo_server_loop;
+    }
+    if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+        if (iperf_instance->isoch.cfg.fps) {
+            return iperf_client_loop_isoch;
+        }
+        if (iperf_instance->trace_path) {
+            return iperf_client_loop_trace;
+        }
+        if (iperf_instance->model.is_active) {
+            return iperf_client_loop_model;
+        }
+        if (iperf_instance->file_path) {
+            return iperf_client_loop_file;
+        }
+        if (is_udp) {
+            return is_paced ? iperf_client_loop_udp_paced : iperf_client_loop_udp;
+        }
+        if (iperf_instance->socket_info.iov_count > 1) {
+            return iperf_client_loop_iov;
+        }
+        return is_paced ? iperf_client_loop_tcp_paced : iperf_client_loop_tcp;
+    }
+    return is_udp ? iperf_server_loop_udp : iperf_server_loop_tcp;
+}
+
+/*************************************************
+ * BSD socket transport
+ *************************************************/
+IRAM_ATTR static int iperf_socket_send(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, size_t len)
+{
+    return sendto(iperf_instance->socket, buffer, len, 0,
+                  (struct sockaddr *) &iperf_instance->socket_info.target_addr, sizeof(struct sockaddr));
+}
+
+IRAM_ATTR static int iperf_socket_send_iov(iperf_instance_data_t *iperf_instance, const struct iovec *iov, int iov_count)
+{
+    struct msghdr msg = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = iov_count,
+    };
+
+    return sendmsg(iperf_instance->socket, &msg, 0);
+}
+
+IRAM_ATTR static int iperf_socket_recv(iperf_instance_data_t *iperf_instance, uint8_t *buffer, size_t len)
+{
+#if IPERF_IPV6_ENABLED && IPERF_IPV4_ENABLED
+    socklen_t socklen = (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+#elif IPERF_IPV6_ENABLED
+    socklen_t socklen = sizeof(struct sockaddr_in6);
+#else
+    socklen_t socklen = sizeof(struct sockaddr_in);
+#endif
+
+    return recvfrom(iperf_instance->socket, buffer, len, 0,
+                    (struct sockaddr *)&iperf_instance->socket_info.target_addr, &socklen);
+}
+
+static void iperf_socket_close(iperf_instance_data_t *iperf_instance)
+{
+    if (iperf_instance->socket != -1) {
+        shutdown(iperf_instance->socket, 0);
+        close(iperf_instance->socket);
+        iperf_instance->socket = -1;
+        ESP_LOGD(TAG_ID, "socket is closed");
+    }
+    if (iperf_instance->listen_socket != -1) {
+        shutdown(iperf_instance->listen_socket, 0);
+        close(iperf_instance->listen_socket);
+        iperf_instance->listen_socket = -1;
+        ESP_LOGD(TAG_ID, "TCP listen socket is closed.");
+    }
+}
+
+/* release possibly blocking server recv */
+static void iperf_socket_abort(iperf_instance_data_t *iperf_instance)
+{
+    if ((iperf_instance->flags & IPERF_FLAG_SERVER) && iperf_instance->socket != -1) {
+        shutdown(iperf_instance->socket, 0);
+        close(iperf_instance->socket);
+        iperf_instance->socket = -1;
+    }
+}
+
+/* UDP client: repeat the final datagram until the server answers with the statistics of the run */
+static void iperf_socket_finish(iperf_instance_data_t *iperf_instance)
+{
+    iperf_udp_rx_stats_t *stats = &iperf_instance->udp_rx_stats;
+    struct {
+        iperf_udp_datagram_hdr_t hdr;
+        iperf_udp_server_report_t report;
+    } reply;
+    struct timeval timeout = {
+        .tv_sec = 0,
+        .tv_usec = IPERF_UDP_FIN_TIMEOUT_MS * 1000,
+    };
+
+    if (!(iperf_instance->flags & IPERF_FLAG_CLIENT) || !(iperf_instance->flags & IPERF_FLAG_UDP) ||
+            iperf_instance->socket == -1 || iperf_instance->udp_tx_datagrams == 0) {
+        return;
+    }
+    int32_t fin_id = htonl(-(int32_t)iperf_instance->udp_tx_datagrams);
+    memcpy(iperf_instance->socket_info.buffer, &fin_id, sizeof(fin_id));
+    if (setsockopt(iperf_instance->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        ESP_LOGW(TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
+        return;
+    }
+    for (int retry = 0; retry < IPERF_UDP_FIN_RETRIES; retry++) {
+        if (iperf_socket_send(iperf_instance, iperf_instance->socket_info.buffer, iperf_instance->socket_info.buffer_len) < 0 &&
+                errno != ENOMEM && errno != ENOBUFS) {
+            break;
+        }
+        if (recv(iperf_instance->socket, &reply, sizeof(reply), 0) == sizeof(reply)) {
+            atomic_store(&stats->datagrams, ntohl(reply.report.datagrams));
+            atomic_store(&stats->lost, ntohl(reply.report.error_cnt));
+            atomic_store(&stats->out_of_order, ntohl(reply.report.outorder_cnt));
+            atomic_store(&stats->jitter_q4, ((uint32_t)ntohl(reply.report.jitter1) * 1000000 + ntohl(reply.report.jitter2)) << 4);
+            ESP_LOGD(TAG_ID, "server received %" PRIu32 " datagrams, %" PRIu32 " lost", ntohl(reply.report.datagrams), ntohl(reply.report.error_cnt));
+            return;
+        }
+    }
+    ESP_LOGW(TAG_ID, "UDP server did not report its statistics");
+}
+
+/*
+ * Socket tuning of the configuration: buffer sizes, TCP_NODELAY and MSS. Set before connect or listen, so that the
+ * window and MSS are announced in the handshake. An option refused by the socket layer (lwIP has no SO_SNDBUF or
+ * TCP_MAXSEG, and SO_RCVBUF only with LWIP_SO_RCVBUF) is dropped, the test runs with the default. Each option is warned
+ * about once per instance, not for every socket, accepted connection or run.
+ */
+static void iperf_socket_tuning_refused(iperf_instance_data_t *iperf_instance, uint8_t option, const char *name)
+{
+    if (!(iperf_instance->socket_info.tuning_warned & option)) {
+        ESP_LOGW(TAG_ID, "failed to set %s - errno %d, default used", name, errno);
+        iperf_instance->socket_info.tuning_warned |= option;
+    }
+}
+
+/* socket buffer size: the socket layer may round it (linux doubles it), returns the size read back, 0 if refused */
+static int iperf_socket_set_buf_len(iperf_instance_data_t *iperf_instance, int sock, int optname, int *len, uint8_t option, const char *name)
+{
+    int applied = 0;
+    socklen_t applied_len = sizeof(applied);
+
+    if (*len == 0) {
+        return 0;
+    }
+    if (setsockopt(sock, SOL_SOCKET, optname, len, sizeof(*len)) != 0) {
+        iperf_socket_tuning_refused(iperf_instance, option, name);
+        *len = 0;
+        return 0;
+    }
+    if (getsockopt(sock, SOL_SOCKET, optname, &applied, &applied_len) != 0) {
+        // set, but not readable back
+        applied = *len;
+    }
+    return applied;
+}
+
+static void iperf_socket_set_tuning(iperf_instance_data_t *iperf_instance, int sock)
+{
+    iperf_socket_info_t *info = &iperf_instance->socket_info;
+    int opt = 1;
+
+    info->sndbuf_applied = iperf_socket_set_buf_len(iperf_instance, sock, SO_SNDBUF, &info->sndbuf_len, IPERF_TUNING_SNDBUF, "SO_SNDBUF");
+    info->rcvbuf_applied = iperf_socket_set_buf_len(iperf_instance, sock, SO_RCVBUF, &info->rcvbuf_len, IPERF_TUNING_RCVBUF, "SO_RCVBUF");
+    if (!(iperf_instance->flags & IPERF_FLAG_TCP)) {
+        return;
+    }
+    if ((iperf_instance->flags & IPERF_FLAG_NODELAY) && setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) != 0) {
+        iperf_socket_tuning_refused(iperf_instance, IPERF_TUNING_NODELAY, "TCP_NODELAY");
+        IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_NODELAY);
+    }
+    if (info->mss != 0) {
+#ifdef TCP_MAXSEG
+        if (setsockopt(sock, IPPROTO_TCP, TCP_MAXSEG, &info->mss, sizeof(info->mss)) != 0) {
+            iperf_socket_tuning_refused(iperf_instance, IPERF_TUNING_MSS, "TCP_MAXSEG");
+            info->mss = 0;
+        }
+#else
+        if (!(info->tuning_warned & IPERF_TUNING_MSS)) {
+            ESP_LOGW(TAG_ID, "MSS is not supported by the socket layer, default used");
+            info->tuning_warned |= IPERF_TUNING_MSS;
+        }
+        info->mss = 0;
+#endif
+    }
+}
+
+/* options of an accepted TCP server connection */
+static esp_err_t iperf_socket_setup_accepted(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    struct timeval timeout = {
+        .tv_sec = IPERF_SOCKET_RX_TIMEOUT,
+    };
+
+    ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
+    ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IP_TOS - errno %d", errno);
+    // lwIP connections do not inherit the options of the listen socket
+    iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
+err:
+    return ret;
+}
+
+static esp_err_t iperf_socket_open_tcp_server(iperf_instance_data_t *iperf_instance)
+{
+    int listen_socket = -1;
+    int opt = 1;
+    esp_err_t ret = ESP_OK;
+    struct timeval timeout = { 0 };
+    socklen_t addr_len = sizeof(struct sockaddr);
+    struct sockaddr_storage listen_addr = { 0 };
+#if IPERF_IPV4_ENABLED
+    struct sockaddr_in listen_addr4 = { 0 };
+    struct sockaddr_in remote_addr = { 0 };
+#endif
+#if IPERF_IPV6_ENABLED
+    struct sockaddr_in6 listen_addr6 = { 0 };
+    struct sockaddr_in6 remote_addr6 = { 0 };
+#endif
+    if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) {
+#if IPERF_IPV6_ENABLED
+        memcpy(&listen_addr6.sin6_addr, iperf_instance->socket_info.source.u_addr.ip6.addr, sizeof(listen_addr6.sin6_addr));
+        listen_addr6.sin6_family = AF_INET6;
+        listen_addr6.sin6_port = htons(iperf_instance->socket_info.sport);
+
+        listen_socket = socket(AF_INET6, SOCK_STREAM, IPPROTO_IPV6);
+        ESP_GOTO_ON_FALSE((listen_socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: unable to create socket - errno %d", errno);
+
+        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
+        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IPV6_V6ONLY - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, listen_socket);
+
+        ESP_GOTO_ON_FALSE(bind(listen_socket, (struct sockaddr *)&listen_addr6, sizeof(listen_addr6)) == 0,
+                          ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to bind - errno %d, IPPROTO: %d", errno, AF_INET6);
+        ESP_GOTO_ON_FALSE(listen(listen_socket, 0) == 0, ESP_FAIL, err, TAG_ID, "cannot start TCP server: an error occurred during listen - errno %d", errno);
+
+        memcpy(&listen_addr, &listen_addr6, sizeof(listen_addr6));
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot start TCP server: invalid address type");
+#endif
+    } else if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V4) {
+#if IPERF_IPV4_ENABLED
+        listen_addr4.sin_family = AF_INET;
+        listen_addr4.sin_port = htons(iperf_instance->socket_info.sport);
+        listen_addr4.sin_addr.s_addr = iperf_instance->socket_info.source.u_addr.ip4.addr;
+
+        listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        ESP_GOTO_ON_FALSE((listen_socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: unable to create socket - errno %d", errno);
+
+        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, listen_socket);
+
+        ESP_GOTO_ON_FALSE(bind(listen_socket, (struct sockaddr *)&listen_addr4, sizeof(listen_addr4)) == 0,
+                          ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to bind - errno %d, IPPROTO: %d", errno, AF_INET);
+
+        ESP_GOTO_ON_FALSE(listen(listen_socket, 0) == 0, ESP_FAIL, err, TAG_ID, "cannot start TCP server: an error occurred during listen - errno %d", errno);
+        memcpy(&listen_addr, &listen_addr4, sizeof(listen_addr4));
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot start TCP server: invalid address type");
+#endif
+    }
+    ESP_LOGI(TAG_ID, "[TCP Server] Socket created");
+    // a daemon waits for its first client in the traffic loop, without accept timeout
+    if (!(iperf_instance->flags & IPERF_FLAG_DAEMON)) {
+        timeout.tv_sec = IPERF_SOCKET_ACCEPT_TIMEOUT;
+        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
+
+        if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V6) {
+#if IPERF_IPV6_ENABLED
+            iperf_instance->socket = accept(listen_socket, (struct sockaddr *)&remote_addr6, &addr_len);
+            ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to accept connection - errno %d", errno);
+            char addr_str[INET6_ADDRSTRLEN];
+            inet6_ntoa_r(remote_addr6.sin6_addr, addr_str, sizeof(addr_str));
+            ESP_LOGD(TAG_ID, "accept: [%s]:%d", addr_str, htons(remote_addr6.sin6_port));
+#endif
+        } else if (iperf_instance->socket_info.source.type == ESP_IPADDR_TYPE_V4) {
+#if IPERF_IPV4_ENABLED
+            iperf_instance->socket = accept(listen_socket, (struct sockaddr *)&remote_addr, &addr_len);
+            ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP server: socket is unable to accept connection - errno %d, socket: %d", errno, listen_socket);
+            char addr_str[INET_ADDRSTRLEN];
+            inet_ntoa_r(remote_addr.sin_addr, addr_str, sizeof(addr_str));
+            ESP_LOGD(TAG_ID, "accept: %s:%d", addr_str, htons(remote_addr.sin_port));
+#endif
+        }
+
+        ret = iperf_socket_setup_accepted(iperf_instance);
+        if (ret != ESP_OK) {
+            goto err;
+        }
     }
-
-    if (listen_socket != -1) {
-        shutdown(listen_socket, 0);
-        close(listen_socket);
-        ESP_LOGD(TAG_ID, "TCP listen socket is closed.");
+    if (iperf_instance->flags & (IPERF_FLAG_CRR | IPERF_FLAG_DAEMON)) {
+        // further connections are accepted by the traffic loop, which must notice a stopped instance
+        timeout.tv_sec = 0;
+        timeout.tv_usec = IPERF_ACCEPT_POLL_MS * 1000;
+        ESP_GOTO_ON_FALSE(setsockopt(listen_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
     }
+    iperf_instance->socket_info.target_addr = listen_addr;
+    iperf_instance->listen_socket = listen_socket;
+    return ESP_OK;
+err:
+    iperf_instance->listen_socket = listen_socket;
+    iperf_socket_close(iperf_instance);
     return ret;
 }
 
-static esp_err_t iperf_start_and_run_tcp_client(iperf_instance_data_t *iperf_instance)
+static esp_err_t iperf_socket_open_tcp_client(iperf_instance_data_t *iperf_instance)
 {
     esp_err_t ret = ESP_OK;
     struct timeval timeout = { 0 };
@@ -391,6 +1921,7 @@ static esp_err_t iperf_start_and_run_tcp_client(iperf_instance_data_t *iperf_ins
 #if IPERF_IPV6_ENABLED
         iperf_instance->socket = socket(AF_INET6, SOCK_STREAM, IPPROTO_IPV6);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP client: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         memcpy(&dest_addr6.sin6_addr, iperf_instance->socket_info.destination.u_addr.ip6.addr, 16); // ipv6 address is 16 bytes
         dest_addr6.sin6_family = AF_INET6;
@@ -407,6 +1938,7 @@ static esp_err_t iperf_start_and_run_tcp_client(iperf_instance_data_t *iperf_ins
 #if IPERF_IPV4_ENABLED
         iperf_instance->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start TCP client: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         dest_addr4.sin_family = AF_INET;
         dest_addr4.sin_port = htons(iperf_instance->socket_info.dport);
@@ -423,25 +1955,13 @@ static esp_err_t iperf_start_and_run_tcp_client(iperf_instance_data_t *iperf_ins
     ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IPERF_SOCKET_TCP_TX_TIMEOUT - errno %d", errno);
     ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IP_TOS - errno %d", errno);
 
-    ESP_GOTO_ON_ERROR(iperf_start_timers(iperf_instance), err, TAG_ID, "failed to start internal timers");
-    // if loop finished prematurely due to error
-    if (iperf_client_loop(iperf_instance) != ESP_OK) {
-        goto err;
-    }
-    goto exit;
+    return ESP_OK;
 err:
-    iperf_stop_exec(iperf_instance);
-exit:
-    if (iperf_instance->socket != -1) {
-        shutdown(iperf_instance->socket, 0);
-        close(iperf_instance->socket);
-        iperf_instance->socket = -1;
-        ESP_LOGD(TAG_ID, "TCP Socket client is closed.");
-    }
+    iperf_socket_close(iperf_instance);
     return ret;
 }
 
-static esp_err_t iperf_start_and_run_udp_server(iperf_instance_data_t *iperf_instance)
+static esp_err_t iperf_socket_open_udp_server(iperf_instance_data_t *iperf_instance)
 {
     int opt = 1;
     esp_err_t ret = ESP_OK;
@@ -461,6 +1981,7 @@ static esp_err_t iperf_start_and_run_udp_server(iperf_instance_data_t *iperf_ins
 
         iperf_instance->socket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start UDP server: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
 
@@ -481,6 +2002,7 @@ static esp_err_t iperf_start_and_run_udp_server(iperf_instance_data_t *iperf_ins
         listen_addr4.sin_addr.s_addr = iperf_instance->socket_info.source.u_addr.ip4.addr;
         iperf_instance->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start UDP server: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
         ESP_GOTO_ON_FALSE(bind(iperf_instance->socket, (struct sockaddr *)&listen_addr4, sizeof(struct sockaddr_in)) == 0,
@@ -499,25 +2021,13 @@ static esp_err_t iperf_start_and_run_udp_server(iperf_instance_data_t *iperf_ins
     ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
     ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IP_TOS - errno %d", errno);
     iperf_instance->socket_info.target_addr = listen_addr;
-
-    // if loop finished prematurely due to error
-    if (iperf_server_loop(iperf_instance) != ESP_OK) {
-        goto err;
-    }
-    goto exit;
+    return ESP_OK;
 err:
-    iperf_stop_exec(iperf_instance);
-exit:
-    if (iperf_instance->socket != -1) {
-        shutdown(iperf_instance->socket, 0);
-        close(iperf_instance->socket);
-        iperf_instance->socket = -1;
-    }
-    ESP_LOGD(TAG_ID, "UDP socket server is closed.");
+    iperf_socket_close(iperf_instance);
     return ret;
 }
 
-static esp_err_t iperf_start_and_run_udp_client(iperf_instance_data_t *iperf_instance)
+static esp_err_t iperf_socket_open_udp_client(iperf_instance_data_t *iperf_instance)
 {
     int opt = 1;
     esp_err_t ret = ESP_OK;
@@ -536,6 +2046,7 @@ static esp_err_t iperf_start_and_run_udp_client(iperf_instance_data_t *iperf_ins
 
         iperf_instance->socket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_IPV6);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start UDP client: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
         memcpy(&iperf_instance->socket_info.target_addr, &dest_addr6, sizeof(dest_addr6));
@@ -564,6 +2075,7 @@ static esp_err_t iperf_start_and_run_udp_client(iperf_instance_data_t *iperf_ins
 
         iperf_instance->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         ESP_GOTO_ON_FALSE((iperf_instance->socket >= 0), ESP_FAIL, err, TAG_ID, "cannot start UDP client: unable to create socket - errno %d", errno);
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
 
         ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_REUSEADDR - errno %d", errno);
         memcpy(&iperf_instance->socket_info.target_addr, &dest_addr4, sizeof(dest_addr4));
@@ -588,41 +2100,214 @@ static esp_err_t iperf_start_and_run_udp_client(iperf_instance_data_t *iperf_ins
 
     ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) == 0, ESP_FAIL, err, TAG_ID, "failed to set IP_TOS - errno %d", errno);
 
-    ESP_GOTO_ON_ERROR(iperf_start_timers(iperf_instance), err, TAG_ID, "failed to start internal timers");
-    // if loop finished prematurely due to error
-    if (iperf_client_loop(iperf_instance) != ESP_OK) {
-        goto err;
+    return ESP_OK;
+err:
+    iperf_socket_close(iperf_instance);
+    return ret;
+}
+
+/* request/response: small segments must not wait to be coalesced, a client must notice lost UDP responses */
+static esp_err_t iperf_socket_setup_rr(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    int opt = 1;
+    struct timeval timeout = {
+        .tv_sec = IPERF_SOCKET_RX_TIMEOUT,
+    };
+
+    if (iperf_instance->flags & IPERF_FLAG_TCP) {
+        ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) == 0, ESP_FAIL, err, TAG_ID, "failed to set TCP_NODELAY - errno %d", errno);
+    }
+    if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+        if (iperf_instance->flags & IPERF_FLAG_UDP) {
+            timeout.tv_sec = 0;
+            timeout.tv_usec = IPERF_RR_UDP_RESPONSE_TMO_MS * 1000;
+        }
+        ESP_GOTO_ON_FALSE(setsockopt(iperf_instance->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0, ESP_FAIL, err, TAG_ID, "failed to set SO_RCVTIMEO - errno %d", errno);
     }
-    goto exit;
 err:
-    iperf_stop_exec(iperf_instance);
-exit:
+    return ret;
+}
+
+/*
+ * TCP connection rate: a client closes its connection and connects again, a server closes the accepted connection and
+ * accepts the next one. A daemon server accepts its next client the same way.
+ * Failures are counted by the caller, so they are not logged here.
+ */
+static esp_err_t iperf_socket_reconnect(iperf_instance_data_t *iperf_instance)
+{
     if (iperf_instance->socket != -1) {
-        shutdown(iperf_instance->socket, 0);
         close(iperf_instance->socket);
         iperf_instance->socket = -1;
     }
-    ESP_LOGD(TAG_ID, "UDP Socket client is closed");
-    return ret;
+    if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+        int family = iperf_instance->socket_info.target_addr.ss_family;
+        socklen_t addr_len = (family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        iperf_instance->socket = socket(family, SOCK_STREAM, IPPROTO_TCP);
+        if (iperf_instance->socket < 0) {
+            return ESP_FAIL;
+        }
+        iperf_socket_set_tuning(iperf_instance, iperf_instance->socket);
+        if (connect(iperf_instance->socket, (struct sockaddr *)&iperf_instance->socket_info.target_addr, addr_len) != 0) {
+            return ESP_FAIL;
+        }
+    } else {
+        // the listen socket times out periodically, so that a stopped instance is noticed
+        while (iperf_instance->is_running && iperf_instance->socket < 0) {
+            iperf_instance->socket = accept(iperf_instance->listen_socket, NULL, NULL);
+            if (iperf_instance->socket < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                return ESP_FAIL;
+            }
+        }
+        if (iperf_instance->socket < 0) {
+            return ESP_FAIL;
+        }
+        if (iperf_socket_setup_accepted(iperf_instance) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    if ((iperf_instance->flags & IPERF_FLAG_CLIENT) &&
+            setsockopt(iperf_instance->socket, IPPROTO_IP, IP_TOS, &(iperf_instance->socket_info.tos), sizeof(iperf_instance->socket_info.tos)) != 0) {
+        return ESP_FAIL;
+    }
+    if (iperf_instance->flags & IPERF_FLAG_RR) {
+        return iperf_socket_setup_rr(iperf_instance);
+    }
+    return ESP_OK;
 }
 
-static void iperf_traffic_task(void *arg)
+static esp_err_t iperf_socket_open(iperf_instance_data_t *iperf_instance)
 {
-    // prevent compiler from producing warning because ret is not used, but needed by ESP_GOTO_ON_ERROR
-    __attribute__((unused)) esp_err_t ret;
-    iperf_instance_data_t *iperf_instance = (iperf_instance_data_t *) arg;
+    esp_err_t ret;
+
     if (iperf_is_tcp_server(iperf_instance)) {
-        ESP_GOTO_ON_ERROR(iperf_start_and_run_tcp_server(iperf_instance), err, TAG_ID, "an error occurred while running tcp server");
+        ret = iperf_socket_open_tcp_server(iperf_instance);
     } else if (iperf_is_tcp_client(iperf_instance)) {
-        ESP_GOTO_ON_ERROR(iperf_start_and_run_tcp_client(iperf_instance), err, TAG_ID, "an error occurred while running tcp client");
+        ret = iperf_socket_open_tcp_client(iperf_instance);
     }  else if (iperf_is_udp_server(iperf_instance)) {
-        ESP_GOTO_ON_ERROR(iperf_start_and_run_udp_server(iperf_instance), err, TAG_ID, "an error occurred while running udp server");
+        ret = iperf_socket_open_udp_server(iperf_instance);
     }  else if (iperf_is_udp_client(iperf_instance)) {
-        ESP_GOTO_ON_ERROR(iperf_start_and_run_udp_client(iperf_instance), err, TAG_ID, "an error occurred while running udp client");
+        ret = iperf_socket_open_udp_client(iperf_instance);
     } else {
-        ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot start iperf-related tasks: invalid mode (TCP/UDP) or role (client/server)");
+        ESP_LOGE(TAG_ID, "cannot start iperf-related tasks: invalid mode (TCP/UDP) or role (client/server)");
+        return ESP_ERR_INVALID_ARG;
+    }
+    // a daemon TCP server has no connection before its first client
+    if (ret == ESP_OK && (iperf_instance->flags & IPERF_FLAG_RR) && iperf_instance->socket != -1) {
+        ret = iperf_socket_setup_rr(iperf_instance);
+    }
+    return ret;
+}
+
+static bool iperf_socket_wait_writable(iperf_instance_data_t *iperf_instance, uint32_t timeout_ms)
+{
+    fd_set write_set;
+    struct timeval timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+
+    FD_ZERO(&write_set);
+    FD_SET(iperf_instance->socket, &write_set);
+    return select(iperf_instance->socket + 1, NULL, &write_set, NULL, &timeout) > 0;
+}
+
+static const iperf_transport_t iperf_transport_socket = {
+    .name = "socket",
+    .open = iperf_socket_open,
+    .send = iperf_socket_send,
+    .recv = iperf_socket_recv,
+    .close = iperf_socket_close,
+    .abort = iperf_socket_abort,
+    .reply = iperf_socket_send,
+    .finish = iperf_socket_finish,
+    .reconnect = iperf_socket_reconnect,
+    .wait_writable = iperf_socket_wait_writable,
+    .send_iov = iperf_socket_send_iov,
+};
+
+/* one run of the instance, a warm instance runs again after iperf_restart_instance() */
+static void iperf_traffic_run(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    const iperf_transport_t *transport = iperf_instance->transport;
+
+    if (!iperf_instance->conn_kept) {
+        ESP_GOTO_ON_ERROR(transport->open(iperf_instance), err, TAG_ID, "cannot open %s transport", transport->name);
     }
+    iperf_traffic_loop_t traffic_loop = iperf_get_traffic_loop(iperf_instance);
+    ESP_GOTO_ON_ERROR(iperf_load_start(iperf_instance), err, TAG_ID, "failed to start load");
+    if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+        ESP_GOTO_ON_ERROR(iperf_start_timers(iperf_instance), err, TAG_ID, "failed to start internal timers");
+        iperf_instance->start_latency_us = esp_timer_get_time() - iperf_instance->start_us;
+    }
+    ret = traffic_loop(iperf_instance);
+    iperf_isoch_summarize(iperf_instance);
+    // if loop finished prematurely due to error
+    ESP_GOTO_ON_ERROR(ret, err, TAG_ID, "an error occurred while running traffic over %s transport", transport->name);
+    if (transport->finish) {
+        transport->finish(iperf_instance);
+    }
+    goto exit;
 err:
+    iperf_stop_exec(iperf_instance);
+exit:
+    iperf_load_stop(iperf_instance);
+    if (transport->get_stats) {
+        transport->get_stats(iperf_instance, &iperf_instance->transport_stats);
+    }
+    // a failed connection is not reused
+    iperf_instance->conn_kept = (iperf_instance->flags & IPERF_FLAG_KEEP_CONN) && ret == ESP_OK && !atomic_load(&iperf_instance->release);
+    if (!iperf_instance->conn_kept) {
+        transport->close(iperf_instance);
+    }
+    atomic_store(&iperf_instance->traffic_finished, true);
+    if (iperf_instance->report_task_hdl) {
+        xTaskNotifyGive(iperf_instance->report_task_hdl);
+    }
+}
+
+/* warm instance: wait for the summary of the run, then for a restart. False when the instance is to be deleted */
+static bool iperf_traffic_park(iperf_instance_data_t *iperf_instance)
+{
+    if (!(iperf_instance->flags & IPERF_FLAG_WARM)) {
+        return false;
+    }
+    // the report task notifies once it printed the summary and parked
+    while (!atomic_load(&iperf_instance->report_parked) && !atomic_load(&iperf_instance->release)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    atomic_store(&iperf_instance->parked, true);
+    if (!atomic_load(&iperf_instance->release)) {
+        iperf_state_action(IPERF_PARKED, iperf_instance);
+    }
+    while (atomic_load(&iperf_instance->parked) && !atomic_load(&iperf_instance->release)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    if (atomic_load(&iperf_instance->release)) {
+        atomic_store(&iperf_instance->parked, false);
+        return false;
+    }
+    // the report task follows into the next run
+    atomic_store(&iperf_instance->report_parked, false);
+    xTaskNotifyGive(iperf_instance->report_task_hdl);
+    return true;
+}
+
+static void iperf_traffic_task(void *arg)
+{
+    iperf_instance_data_t *iperf_instance = (iperf_instance_data_t *) arg;
+
+    do {
+        iperf_traffic_run(iperf_instance);
+    } while (iperf_traffic_park(iperf_instance));
+    if (iperf_instance->flags & IPERF_FLAG_WARM) {
+        if (iperf_instance->conn_kept) {
+            iperf_instance->transport->close(iperf_instance);
+        }
+        // stopped right after a restart, the report task may have started the run already
+        iperf_stop_exec(iperf_instance);
+    }
     iperf_instance->traffic_task_hdl = NULL;
     iperf_delete_instance(iperf_instance);
     ESP_LOGD(TAG_ID, "traffic task is to be deleted");
@@ -644,10 +2329,8 @@ static esp_err_t iperf_stop_exec(iperf_instance_data_t *iperf_instance)
         }
     }
     // release possibly blocking server recv loop
-    if ((iperf_instance->flags & IPERF_FLAG_SERVER) && iperf_instance->socket != -1) {
-        shutdown(iperf_instance->socket, 0);
-        close(iperf_instance->socket);
-        iperf_instance->socket = -1;
+    if (iperf_instance->transport && iperf_instance->transport->abort) {
+        iperf_instance->transport->abort(iperf_instance);
     }
 
     // release report task
@@ -697,6 +2380,8 @@ static int iperf_esp_err_to_errno(esp_err_t esp_err)
         return EBUSY;
     case ESP_ERR_INVALID_STATE:
         return ENODEV;
+    case ESP_ERR_NOT_SUPPORTED:
+        return EOPNOTSUPP;
     }
     return EIO;
 }
@@ -806,9 +2491,12 @@ static esp_err_t iperf_list_remove_instance(iperf_instance_data_t *iperf_instanc
     return ret;
 }
 
-static uint32_t iperf_get_buffer_len(iperf_instance_data_t *iperf_instance, uint16_t data_len)
+static uint32_t iperf_get_buffer_len(iperf_instance_data_t *iperf_instance, uint32_t data_len)
 {
-    if (iperf_is_udp_client(iperf_instance)) {
+    if ((iperf_instance->flags & IPERF_FLAG_RR) && (iperf_instance->flags & IPERF_FLAG_CLIENT)) {
+        // holds a request or, in one receive, a response
+        return MAX(iperf_instance->rr_request_len, iperf_instance->rr_response_len);
+    } else if (iperf_is_udp_client(iperf_instance)) {
 #if IPERF_IPV6_ENABLED
         if (data_len) {
             return data_len;
@@ -830,12 +2518,49 @@ static uint32_t iperf_get_buffer_len(iperf_instance_data_t *iperf_instance, uint
     return 0;
 }
 
+static const iperf_transport_t *iperf_get_transport(iperf_transport_type_t type)
+{
+    switch (type) {
+    case IPERF_TRANSPORT_SOCKET:
+        return &iperf_transport_socket;
+#if IPERF_NETCONN_SUPPORTED
+    case IPERF_TRANSPORT_NETCONN:
+        return &iperf_transport_netconn;
+#endif
+#if IPERF_MEMORY_TRANSPORT_SUPPORTED
+    case IPERF_TRANSPORT_MEMORY:
+        return &iperf_transport_memory;
+#endif
+    default:
+        return NULL;
+    }
+}
+
 static esp_err_t iperf_force_stop(iperf_instance_data_t *iperf_instance, void *ctx)
 {
     esp_err_t ret = ESP_OK;
     ESP_GOTO_ON_FALSE(iperf_instance != NULL, ESP_FAIL, err, TAG, "cannot stop instance: instance not found");
     ESP_LOGI(TAG, "waiting for iperf instance id=%" PRIi8 " to stop...", iperf_instance->id);
     iperf_instance->time = IPERF_TIME_FORCE_ELAPSED;
+    if (iperf_instance->flags & IPERF_FLAG_WARM) {
+        // no further runs, parked tasks exit
+        atomic_store(&iperf_instance->release, true);
+        if (atomic_load(&iperf_instance->report_parked)) {
+            xTaskNotifyGive(iperf_instance->report_task_hdl);
+        }
+        if (iperf_instance->traffic_task_hdl) {
+            // parked, or waiting for the report task to park
+            xTaskNotifyGive(iperf_instance->traffic_task_hdl);
+        }
+    }
+    if (iperf_instance->flags & IPERF_FLAG_DAEMON) {
+        // the timers of a daemon run only while it serves a client
+        iperf_stop_exec(iperf_instance);
+        // release the traffic task if it waits for the summary of a client
+        if (iperf_instance->traffic_task_hdl) {
+            xTaskNotifyGive(iperf_instance->traffic_task_hdl);
+        }
+    }
 err:
     return ret;
 }
@@ -866,6 +2591,14 @@ static void iperf_delete_instance(iperf_instance_data_t *iperf_instance)
         iperf_list_remove_instance(iperf_instance);
 
         // free the allocated memory
+        free(iperf_instance->rtt_hist);
+        free(iperf_instance->connect_hist);
+        free(iperf_instance->isoch.latency_hist);
+        free(iperf_instance->trace.error_hist);
+        free(iperf_instance->trace_path);
+        free(iperf_instance->verify.ref);
+        free(iperf_instance->file_path);
+        free(iperf_instance->write_path);
         free(iperf_instance->socket_info.buffer);
         free(iperf_instance);
     }
@@ -878,7 +2611,17 @@ static iperf_traffic_type_t iperf_get_traffic_type_internal(iperf_instance_data_
     __attribute__((unused)) esp_err_t ret;
 
     ESP_GOTO_ON_ERROR(iperf_instance == NULL, err, TAG, "invalid argument");
-    if (iperf_is_tcp_server(iperf_instance)) {
+    if (iperf_instance->flags & IPERF_FLAG_RR) {
+        if (iperf_is_tcp_server(iperf_instance)) {
+            return IPERF_TCP_ECHO_SERVER;
+        } else if (iperf_is_tcp_client(iperf_instance)) {
+            return IPERF_TCP_RR_CLIENT;
+        }  else if (iperf_is_udp_server(iperf_instance)) {
+            return IPERF_UDP_ECHO_SERVER;
+        }  else if (iperf_is_udp_client(iperf_instance)) {
+            return IPERF_UDP_RR_CLIENT;
+        }
+    } else if (iperf_is_tcp_server(iperf_instance)) {
         return IPERF_TCP_SERVER;
     } else if (iperf_is_tcp_client(iperf_instance)) {
         return IPERF_TCP_CLIENT;
@@ -893,6 +2636,282 @@ err:
     return IPERF_TRAFFIC_TYPE_INVALID;
 }
 
+/* settings of a run, applied again by iperf_restart_instance() */
+static esp_err_t iperf_apply_run_cfg(iperf_instance_data_t *iperf_instance, const iperf_cfg_t *cfg)
+{
+    iperf_instance->traffic.output_format = cfg->format;
+    // a daemon is served until stopped, the test time is up to each client
+    iperf_instance->time = (iperf_instance->flags & IPERF_FLAG_DAEMON) ? UINT32_MAX : cfg->time;
+    iperf_instance->interval = cfg->interval;
+    iperf_instance->state_handler = cfg->state_handler;
+    iperf_instance->state_handler_priv = cfg->state_handler_priv;
+    if (iperf_instance->flags & IPERF_FLAG_RR) {
+        if (cfg->len_send_buf > UINT16_MAX) {
+            ESP_LOGW(TAG_ID, "request length is at most %d bytes", UINT16_MAX);
+        }
+        iperf_instance->rr_request_len = cfg->len_send_buf ? MIN(cfg->len_send_buf, UINT16_MAX) : IPERF_RR_MIN_LEN;
+        iperf_instance->rr_response_len = cfg->rr_response_len ? cfg->rr_response_len : iperf_instance->rr_request_len;
+        if (iperf_instance->rr_request_len < IPERF_RR_MIN_LEN || iperf_instance->rr_response_len < IPERF_RR_MIN_LEN) {
+            ESP_LOGW(TAG_ID, "request/response length is at least %d bytes", IPERF_RR_MIN_LEN);
+            iperf_instance->rr_request_len = MAX(iperf_instance->rr_request_len, IPERF_RR_MIN_LEN);
+            iperf_instance->rr_response_len = MAX(iperf_instance->rr_response_len, IPERF_RR_MIN_LEN);
+        }
+    }
+
+    // populate config information about socket, a kept connection stays where it is
+    if (!iperf_instance->conn_kept) {
+        iperf_instance->socket_info.destination = cfg->destination;
+        iperf_instance->socket_info.source = cfg->source;
+        iperf_instance->socket_info.dport = cfg->dport;
+        iperf_instance->socket_info.sport = cfg->sport;
+        iperf_instance->socket_info.tos = cfg->tos;
+        iperf_instance->socket_info.sndbuf_len = MIN(cfg->socket_buf_len, INT32_MAX);
+        iperf_instance->socket_info.rcvbuf_len = MIN(cfg->socket_buf_len, INT32_MAX);
+        iperf_instance->socket_info.mss = cfg->mss;
+        if (cfg->mss != 0 && !(iperf_instance->flags & IPERF_FLAG_TCP)) {
+            ESP_LOGW(TAG_ID, "MSS is only applicable to TCP, ignored");
+            iperf_instance->socket_info.mss = 0;
+        }
+    }
+    iperf_instance->socket_info.buffer_len = iperf_get_buffer_len(iperf_instance, cfg->len_send_buf);
+    if (iperf_is_udp_client(iperf_instance) && iperf_instance->socket_info.buffer_len > IPERF_UDP_MAX_LEN) {
+        ESP_LOGW(TAG_ID, "datagram length is at most %d bytes", IPERF_UDP_MAX_LEN);
+        iperf_instance->socket_info.buffer_len = IPERF_UDP_MAX_LEN;
+    }
+    iperf_instance->socket_info.iov_count = 1;
+    if (cfg->iov_count > 1) {
+        if (!iperf_is_tcp_client(iperf_instance) || (iperf_instance->flags & (IPERF_FLAG_RR | IPERF_FLAG_VERIFY)) ||
+                cfg->file_path != NULL || iperf_instance->transport->send_iov == NULL) {
+            ESP_LOGW(TAG_ID, "gathered sends are only used by bulk TCP clients through sockets, without verify and file, ignored");
+        } else {
+            iperf_instance->socket_info.iov_count = MIN(MIN(cfg->iov_count, IPERF_IOV_MAX_COUNT), iperf_instance->socket_info.buffer_len);
+        }
+    }
+    uint32_t buffer_size = iperf_instance->socket_info.buffer_len;
+    if (iperf_instance->socket_info.iov_count > 1) {
+        // every iovec references the same data
+        buffer_size = (iperf_instance->socket_info.buffer_len + iperf_instance->socket_info.iov_count - 1) / iperf_instance->socket_info.iov_count;
+    }
+    bool is_verify_client = (iperf_instance->flags & IPERF_FLAG_VERIFY) && (iperf_instance->flags & IPERF_FLAG_CLIENT);
+    bool is_verify_server = (iperf_instance->flags & IPERF_FLAG_VERIFY) && (iperf_instance->flags & IPERF_FLAG_SERVER);
+    // TCP client sends start anywhere within the first pattern period
+    uint32_t alloc_size = buffer_size + ((is_verify_client && !(iperf_instance->flags & IPERF_FLAG_UDP)) ? IPERF_VERIFY_PERIOD : 0);
+    if (alloc_size > iperf_instance->socket_info.buffer_size) {
+        free(iperf_instance->socket_info.buffer);
+        iperf_instance->socket_info.buffer_size = 0;
+        iperf_instance->socket_info.buffer = (uint8_t *) calloc(alloc_size, sizeof(uint8_t));
+        ESP_RETURN_ON_FALSE(iperf_instance->socket_info.buffer, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for buffer allocation");
+        iperf_instance->socket_info.buffer_size = alloc_size;
+    }
+    if (is_verify_client) {
+        uint8_t seed = iperf_instance->id;
+        if (iperf_instance->flags & IPERF_FLAG_UDP) {
+            // every datagram carries the pattern after its header
+            if (buffer_size > IPERF_VERIFY_UDP_HDR_LEN) {
+                iperf_verify_fill(iperf_instance->socket_info.buffer + IPERF_VERIFY_UDP_HDR_LEN, buffer_size - IPERF_VERIFY_UDP_HDR_LEN, seed);
+            }
+        } else {
+            iperf_verify_fill(iperf_instance->socket_info.buffer, alloc_size, seed);
+        }
+    }
+    if (is_verify_server) {
+        uint32_t ref_size = iperf_instance->socket_info.buffer_len + IPERF_VERIFY_PERIOD;
+        if (ref_size > iperf_instance->verify.ref_size) {
+            free(iperf_instance->verify.ref);
+            iperf_instance->verify.ref_size = 0;
+            iperf_instance->verify.ref = malloc(ref_size);
+            ESP_RETURN_ON_FALSE(iperf_instance->verify.ref, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for verify pattern");
+            iperf_instance->verify.ref_size = ref_size;
+        }
+        iperf_instance->verify.seed = -1;
+    }
+    // a kept connection continues its stream where the last run ended
+    if (!iperf_instance->conn_kept) {
+        iperf_instance->verify.offset = 0;
+    }
+
+    free(iperf_instance->file_path);
+    iperf_instance->file_path = NULL;
+    if (cfg->file_path != NULL) {
+        if (!(iperf_instance->flags & IPERF_FLAG_CLIENT) || (iperf_instance->flags & (IPERF_FLAG_RR | IPERF_FLAG_VERIFY))) {
+            ESP_LOGW(TAG_ID, "payload file is only sent by bulk transfer clients without verify mode, ignored");
+        } else {
+            iperf_instance->file_path = strdup(cfg->file_path);
+            ESP_RETURN_ON_FALSE(iperf_instance->file_path, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for payload file path");
+        }
+    }
+    free(iperf_instance->write_path);
+    iperf_instance->write_path = NULL;
+    if (cfg->write_path != NULL) {
+        // the netconn server does not copy received data
+        if (!(iperf_instance->flags & IPERF_FLAG_SERVER) || (iperf_instance->flags & IPERF_FLAG_RR) ||
+                cfg->transport == IPERF_TRANSPORT_NETCONN) {
+            ESP_LOGW(TAG_ID, "received data is only written by bulk transfer servers with socket or memory transport, file ignored");
+        } else {
+            iperf_instance->write_path = strdup(cfg->write_path);
+            ESP_RETURN_ON_FALSE(iperf_instance->write_path, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for file path");
+        }
+    }
+
+    // calculate timer period or set default, one Tx credit sends buffer_len bytes also if they are gathered from iovecs
+    iperf_instance->timers.tx_period_us = 0;
+    iperf_instance->bw_lim = IPERF_DEFAULT_NO_BW_LIMIT;
+    if (cfg->bw_lim > 0 && !(iperf_instance->flags & IPERF_FLAG_RR)) {
+        iperf_instance->timers.tx_period_us = (uint64_t)iperf_instance->socket_info.buffer_len * 8 * 1000 * 1000 / cfg->bw_lim;
+        iperf_instance->bw_lim = cfg->bw_lim;
+    }
+
+    // isochronous client: the Tx timer schedules frames, the mean bandwidth takes the place of the bandwidth limit
+    memset(&iperf_instance->isoch.cfg, 0, sizeof(iperf_isoch_cfg_t));
+    if (cfg->isoch.fps > 0) {
+        if (!iperf_is_udp_client(iperf_instance) || (iperf_instance->flags & (IPERF_FLAG_RR | IPERF_FLAG_VERIFY)) ||
+                cfg->isoch.mean_bw <= 0 || cfg->isoch.stdev_bw < 0) {
+            ESP_LOGW(TAG_ID, "isochronous traffic needs a UDP client without verify mode and a positive mean bandwidth, ignored");
+        } else {
+            iperf_instance->isoch.cfg = cfg->isoch;
+            // frame sizes are reproducible per instance id
+            iperf_instance->isoch.prng = 0x9e3779b9 ^ iperf_instance->id;
+            iperf_instance->timers.tx_period_us = MAX(1000 * 1000 / cfg->isoch.fps, 1);
+            iperf_instance->bw_lim = cfg->isoch.mean_bw;
+            if (iperf_instance->file_path) {
+                ESP_LOGW(TAG_ID, "payload file is not sent by an isochronous client, ignored");
+                free(iperf_instance->file_path);
+                iperf_instance->file_path = NULL;
+            }
+        }
+    }
+
+    // trace replay: the Tx timer is started for each wait until the send time of the next record
+    iperf_instance->timers.tx_oneshot = false;
+    free(iperf_instance->trace_path);
+    iperf_instance->trace_path = NULL;
+    iperf_instance->trace.loop = false;
+    if (cfg->trace_path != NULL) {
+        if (!iperf_is_udp_client(iperf_instance) || (iperf_instance->flags & (IPERF_FLAG_RR | IPERF_FLAG_VERIFY)) ||
+                iperf_instance->isoch.cfg.fps || iperf_instance->file_path ||
+                iperf_instance->socket_info.buffer_len < sizeof(iperf_udp_datagram_hdr_t)) {
+            ESP_LOGW(TAG_ID, "trace replay needs a UDP client without verify mode, isochronous traffic or payload file, ignored");
+        } else {
+            iperf_instance->trace_path = strdup(cfg->trace_path);
+            ESP_RETURN_ON_FALSE(iperf_instance->trace_path, ESP_ERR_NO_MEM, TAG_ID, "not enough memory for trace path");
+            iperf_instance->trace.loop = cfg->trace_loop;
+            if (iperf_instance->timers.tx_period_us > 0) {
+                ESP_LOGW(TAG_ID, "the trace sets the send times, bandwidth limit ignored");
+            }
+            iperf_instance->timers.tx_period_us = 0;
+            iperf_instance->bw_lim = IPERF_DEFAULT_NO_BW_LIMIT;
+            iperf_instance->timers.tx_oneshot = true;
+        }
+    }
+
+    // traffic model: a paced client starts the Tx timer for each datagram scheduled by the arrival process
+    memset(&iperf_instance->model, 0, sizeof(iperf_model_t));
+    if (cfg->model.arrival != IPERF_ARRIVAL_CONSTANT || cfg->model.imix[0].weight != 0) {
+        const iperf_traffic_model_t *model = &cfg->model;
+        if (!iperf_is_udp_client(iperf_instance) || (iperf_instance->flags & (IPERF_FLAG_RR | IPERF_FLAG_VERIFY)) ||
+                iperf_instance->isoch.cfg.fps || iperf_instance->file_path || iperf_instance->trace_path ||
+                iperf_instance->socket_info.buffer_len < sizeof(iperf_udp_datagram_hdr_t)) {
+            ESP_LOGW(TAG_ID, "traffic model needs a UDP client without verify mode, isochronous traffic, payload file or trace, ignored");
+        } else if (model->arrival != IPERF_ARRIVAL_CONSTANT && iperf_instance->timers.tx_period_us == 0) {
+            ESP_LOGW(TAG_ID, "arrival process needs a bandwidth limit (-b), ignored");
+        } else if (model->arrival == IPERF_ARRIVAL_ON_OFF && (model->on_ms == 0 || model->off_ms == 0 ||
+                   model->on_ms > IPERF_MODEL_MAX_PHASE_MS || model->off_ms > IPERF_MODEL_MAX_PHASE_MS)) {
+            ESP_LOGW(TAG_ID, "on/off arrivals need burst and pause lengths of 1~%d ms, ignored", IPERF_MODEL_MAX_PHASE_MS);
+        } else {
+            iperf_model_t *inst_model = &iperf_instance->model;
+            uint64_t weighted_len = 0;
+            inst_model->cfg = *model;
+            for (int i = 0; i < IPERF_IMIX_MAX_LENS && model->imix[i].weight; i++) {
+                uint16_t len = MIN(MAX(model->imix[i].len, sizeof(iperf_udp_datagram_hdr_t)), iperf_instance->socket_info.buffer_len);
+                if (len != model->imix[i].len) {
+                    ESP_LOGW(TAG_ID, "datagram length %" PRIu16 " of the mix limited to %" PRIu16, model->imix[i].len, len);
+                }
+                inst_model->cfg.imix[i].len = len;
+                inst_model->imix_weight += model->imix[i].weight;
+                weighted_len += (uint64_t)len * model->imix[i].weight;
+            }
+            inst_model->mean_len = inst_model->imix_weight ? weighted_len / inst_model->imix_weight : iperf_instance->socket_info.buffer_len;
+            // the seed is logged, so that a run can be repeated
+            inst_model->prng = model->seed ? model->seed : 0x9e3779b9 ^ iperf_instance->id;
+            ESP_LOGI(TAG_ID, "traffic model seed %" PRIu32, inst_model->prng);
+            inst_model->is_active = true;
+            iperf_instance->timers.tx_oneshot = iperf_instance->timers.tx_period_us > 0;
+        }
+    }
+
+    // bandwidth ramp, its steps end with report periods so that no period spans two steps
+    memset(&iperf_instance->ramp, 0, sizeof(iperf_ramp_t));
+    if (cfg->ramp.step_bw != 0) {
+        if (!(iperf_instance->flags & IPERF_FLAG_CLIENT) || iperf_instance->timers.tx_period_us == 0 ||
+                cfg->ramp.step_bw < 0 || cfg->ramp.step_sec == 0) {
+            ESP_LOGW(TAG_ID, "bandwidth ramp needs a paced client (-b), a positive step and step time, ignored");
+        } else {
+            uint32_t interval = MAX(iperf_instance->interval, 1);
+            iperf_instance->ramp.cfg = cfg->ramp;
+            iperf_instance->ramp.step = 1;
+            if (cfg->ramp.step_sec % interval != 0) {
+                iperf_instance->ramp.cfg.step_sec = (cfg->ramp.step_sec / interval + 1) * interval;
+                ESP_LOGW(TAG_ID, "bandwidth ramp step is a multiple of the report interval, rounded up to %" PRIu32 " sec",
+                         iperf_instance->ramp.cfg.step_sec);
+            }
+        }
+    }
+
+    // backoff after UDP sends failed for lack of buffers
+    memset(&iperf_instance->backoff, 0, sizeof(iperf_backoff_t));
+    iperf_instance->backoff.cfg = cfg->backoff;
+    if (cfg->backoff.policy != IPERF_BACKOFF_NONE && !iperf_is_udp_client(iperf_instance)) {
+        ESP_LOGW(TAG_ID, "send backoff is for UDP clients, ignored");
+        iperf_instance->backoff.cfg.policy = IPERF_BACKOFF_NONE;
+    } else if (cfg->backoff.policy == IPERF_BACKOFF_SELECT && iperf_instance->transport->wait_writable == NULL) {
+        ESP_LOGW(TAG_ID, "%s transport cannot wait until writable, the send backoff is a delay", iperf_instance->transport->name);
+        iperf_instance->backoff.cfg.policy = IPERF_BACKOFF_DELAY;
+    }
+    if (iperf_instance->backoff.cfg.max_delay_ms == 0) {
+        iperf_instance->backoff.cfg.max_delay_ms = IPERF_BACKOFF_DEFAULT_MAX_DELAY_MS;
+    }
+
+    // load co-runner, its steps end with report periods like the bandwidth ramp
+    memset(&iperf_instance->load, 0, sizeof(iperf_load_t));
+    if (cfg->load.duty_percent != 0 || cfg->load.step_percent != 0) {
+        iperf_load_t *load = &iperf_instance->load;
+        if (cfg->load.duty_percent > 100) {
+            ESP_LOGW(TAG_ID, "load duty cycle is 0~100 %%, ignored");
+        } else {
+            load->cfg = cfg->load;
+            load->is_active = true;
+            atomic_store(&load->duty_percent, cfg->load.duty_percent);
+            if (cfg->load.core >= NUMBER_OF_CORES) {
+                ESP_LOGW(TAG_ID, "no core %" PRIi8 " for the load, it runs on any core", cfg->load.core);
+                load->cfg.core = -1;
+            }
+            if (cfg->load.mem_len != 0 && cfg->load.mem_len < IPERF_LOAD_MIN_MEM_LEN) {
+                ESP_LOGW(TAG_ID, "load buffer raised to %d bytes", IPERF_LOAD_MIN_MEM_LEN);
+                load->cfg.mem_len = IPERF_LOAD_MIN_MEM_LEN;
+            }
+            if (cfg->load.step_percent == 0 || cfg->load.step_sec == 0) {
+                load->cfg.step_sec = 0;
+            } else if (iperf_instance->ramp.cfg.step_sec != 0 || (iperf_instance->flags & IPERF_FLAG_DAEMON)) {
+                ESP_LOGW(TAG_ID, "load steps cannot be combined with a bandwidth ramp or a daemon server, the load is constant");
+                load->cfg.step_sec = 0;
+            } else {
+                uint32_t interval = MAX(iperf_instance->interval, 1);
+                load->step = 1;
+                if (cfg->load.step_sec % interval != 0) {
+                    load->cfg.step_sec = (cfg->load.step_sec / interval + 1) * interval;
+                    ESP_LOGW(TAG_ID, "load step is a multiple of the report interval, rounded up to %" PRIu32 " sec",
+                             load->cfg.step_sec);
+                }
+            }
+        }
+    }
+
+    // a restart with the last configuration starts over from here
+    iperf_instance->start_bw_lim = iperf_instance->bw_lim;
+    iperf_instance->timers.start_tx_period_us = iperf_instance->timers.tx_period_us;
+    return ESP_OK;
+}
+
 iperf_id_t iperf_start_instance(const iperf_cfg_t *cfg)
 {
     esp_err_t ret = ESP_OK;
@@ -919,33 +2938,64 @@ iperf_id_t iperf_start_instance(const iperf_cfg_t *cfg)
     // create instance specific tag used in logs
     snprintf(iperf_instance->tag, sizeof(iperf_instance->tag), TAG_ID_STR, iperf_instance->id);
 
-    iperf_instance->traffic.output_format = cfg->format;
-    iperf_instance->time = cfg->time;
-    iperf_instance->interval = cfg->interval;
     iperf_instance->flags = cfg->flag;
-    if (cfg->state_handler != NULL) {
-        iperf_instance->state_handler = cfg->state_handler;
-        iperf_instance->state_handler_priv = cfg->state_handler_priv;
-    }
-
-    // populate config information about socket
-    iperf_instance->socket_info.destination = cfg->destination;
-    iperf_instance->socket_info.source = cfg->source;
-    iperf_instance->socket_info.dport = cfg->dport;
-    iperf_instance->socket_info.sport = cfg->sport;
-    iperf_instance->socket_info.tos = cfg->tos;
-    iperf_instance->socket_info.buffer_len = iperf_get_buffer_len(iperf_instance, cfg->len_send_buf);
-    iperf_instance->socket_info.buffer = (uint8_t *) calloc(iperf_instance->socket_info.buffer_len, sizeof(uint8_t));
-    ESP_GOTO_ON_FALSE(iperf_instance->socket_info.buffer, ESP_ERR_NO_MEM, err, TAG_ID, "cannot create iperf instance: not enough memory for buffer allocation");
     iperf_instance->socket = -1;
-
-    // calculate timer period or set default
-    if (cfg->bw_lim > 0) {
-        iperf_instance->timers.tx_period_us = (uint64_t)iperf_instance->socket_info.buffer_len * 8 * 1000 * 1000 / cfg->bw_lim;
+    iperf_instance->listen_socket = -1;
+    iperf_instance->transport = iperf_get_transport(cfg->transport);
+    ESP_GOTO_ON_FALSE(iperf_instance->transport, ESP_ERR_NOT_SUPPORTED, err, TAG_ID, "cannot create iperf instance: transport %d is not supported", cfg->transport);
+    if (cfg->transport != IPERF_TRANSPORT_SOCKET &&
+            ((iperf_instance->flags & IPERF_FLAG_NODELAY) ||
+             cfg->socket_buf_len != 0 || cfg->mss != 0)) {
+        ESP_LOGW(TAG_ID, "socket layer options are not used with %s transport, ignored", iperf_instance->transport->name);
+        IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_NODELAY);
+    }
+    if ((iperf_instance->flags & IPERF_FLAG_NODELAY) && !(iperf_instance->flags & IPERF_FLAG_TCP)) {
+        ESP_LOGW(TAG_ID, "no delay is only applicable to TCP, ignored");
+        IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_NODELAY);
+    }
+    if (iperf_instance->flags & IPERF_FLAG_CRR) {
+        ESP_GOTO_ON_FALSE(iperf_instance->flags & IPERF_FLAG_TCP, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot create iperf instance: connection rate mode is TCP only");
+        IPERF_FLAG_SET(iperf_instance->flags, IPERF_FLAG_RR);
+    }
+    if (iperf_instance->flags & IPERF_FLAG_RR) {
+        // the echo role answers through the transport, only the socket transport sends back to a client
+        ESP_GOTO_ON_FALSE(cfg->transport == IPERF_TRANSPORT_SOCKET, ESP_ERR_NOT_SUPPORTED, err, TAG_ID, "cannot create iperf instance: request/response mode needs socket transport");
+        if (iperf_instance->flags & IPERF_FLAG_VERIFY) {
+            ESP_LOGW(TAG_ID, "bulk transfer options are not used in request/response mode, ignored");
+            IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_VERIFY);
+        }
+        if (cfg->bw_lim > 0) {
+            ESP_LOGW(TAG_ID, "bandwidth limit is not used in request/response mode, ignored");
+        }
+        if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+            iperf_instance->rtt_hist = calloc(1, sizeof(iperf_rtt_hist_t));
+            ESP_GOTO_ON_FALSE(iperf_instance->rtt_hist, ESP_ERR_NO_MEM, err, TAG_ID, "cannot create iperf instance: not enough memory for round trip times");
+            if (iperf_instance->flags & IPERF_FLAG_CRR) {
+                iperf_instance->connect_hist = calloc(1, sizeof(iperf_rtt_hist_t));
+                ESP_GOTO_ON_FALSE(iperf_instance->connect_hist, ESP_ERR_NO_MEM, err, TAG_ID, "cannot create iperf instance: not enough memory for connect times");
+            }
+        }
+    }
+    if ((iperf_instance->flags & IPERF_FLAG_VERIFY) && (iperf_instance->flags & IPERF_FLAG_SERVER) && cfg->transport == IPERF_TRANSPORT_NETCONN) {
+        ESP_LOGW(TAG_ID, "netconn server does not copy received data, verify mode ignored");
+        IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_VERIFY);
+    }
+    if (iperf_instance->flags & IPERF_FLAG_DAEMON) {
+        ESP_GOTO_ON_FALSE(iperf_instance->flags & IPERF_FLAG_SERVER, ESP_ERR_INVALID_ARG, err, TAG_ID, "cannot create iperf instance: daemon mode is for servers only");
+        ESP_GOTO_ON_FALSE((iperf_instance->flags & IPERF_FLAG_UDP) || iperf_instance->transport->reconnect, ESP_ERR_NOT_SUPPORTED, err, TAG_ID,
+                          "cannot create iperf instance: %s transport cannot accept further TCP clients", iperf_instance->transport->name);
     }
+    if (iperf_instance->flags & IPERF_FLAG_KEEP_CONN) {
+        if (!iperf_is_tcp_client(iperf_instance) || !(iperf_instance->flags & IPERF_FLAG_WARM) || (iperf_instance->flags & IPERF_FLAG_CRR)) {
+            ESP_LOGW(TAG_ID, "keeping the connection is only applicable to warm TCP client, ignored");
+            IPERF_FLAG_CLR(iperf_instance->flags, IPERF_FLAG_KEEP_CONN);
+        }
+    }
+    ESP_GOTO_ON_ERROR(iperf_apply_run_cfg(iperf_instance, cfg), err, TAG_ID, "cannot create iperf instance: failed to apply config");
     ESP_GOTO_ON_ERROR(iperf_create_timers(iperf_instance), err, TAG_ID, "failed to create timers");
 
     // Start tasks associated with iperf
+    iperf_instance->start_us = esp_timer_get_time();
     ESP_GOTO_ON_ERROR(iperf_start_tasks(iperf_instance, cfg), err, TAG_ID, "cannot start iperf-related tasks: an error has occurred");
 
     // return the id assigned to this instance
@@ -975,3 +3025,138 @@ esp_err_t iperf_stop_instance(iperf_id_t id)
 err:
     return ret;
 }
+
+esp_err_t iperf_set_tx_bandwidth(iperf_instance_data_t *iperf_instance, int32_t bw_lim)
+{
+    esp_err_t ret = ESP_OK;
+    // the traffic loop variant is chosen at start, an unpaced loop does not wait for the Tx timer
+    ESP_RETURN_ON_FALSE(iperf_instance->timers.tx_timer != NULL, ESP_ERR_NOT_SUPPORTED, TAG_ID,
+                        "cannot set bandwidth: instance was started without bandwidth limit");
+    ESP_RETURN_ON_FALSE(iperf_instance->trace_path == NULL, ESP_ERR_NOT_SUPPORTED, TAG_ID,
+                        "cannot set bandwidth: the replayed trace sets the send times");
+    if (iperf_instance->isoch.cfg.fps) {
+        // isochronous client: the frame rate is kept, frames get larger or smaller
+        iperf_instance->isoch.cfg.mean_bw = bw_lim;
+        iperf_instance->bw_lim = bw_lim;
+        ESP_LOGD(TAG_ID, "mean frame bandwidth set to %" PRIi32 " bits/sec", bw_lim);
+        return ESP_OK;
+    }
+    if (iperf_instance->timers.tx_oneshot) {
+        // traffic model: the traffic loop schedules the next datagram with the new bandwidth
+        iperf_instance->bw_lim = bw_lim;
+        ESP_LOGD(TAG_ID, "bandwidth set to %" PRIi32 " bits/sec", bw_lim);
+        return ESP_OK;
+    }
+
+    uint64_t tx_period_us = (uint64_t)iperf_instance->socket_info.buffer_len * 8 * 1000 * 1000 / bw_lim;
+    iperf_instance->timers.tx_period_us = MAX(tx_period_us, 1);
+    // a running timer is restarted, the next send waits for one new period. A timer not started yet uses the new
+    // period when it starts, also if that happens in between stop and start here.
+    if (iperf_instance->is_running && esp_timer_stop(iperf_instance->timers.tx_timer) == ESP_OK) {
+        ret = esp_timer_start_periodic(iperf_instance->timers.tx_timer, iperf_instance->timers.tx_period_us);
+        ESP_RETURN_ON_FALSE(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE, ret, TAG_ID, "failed to restart Tx timer");
+    }
+    iperf_instance->bw_lim = bw_lim;
+    ESP_LOGD(TAG_ID, "bandwidth set to %" PRIi32 " bits/sec, Tx period %" PRIu64 " us", bw_lim, iperf_instance->timers.tx_period_us);
+    return ESP_OK;
+}
+
+esp_err_t iperf_set_bandwidth(iperf_id_t id, int32_t bw_lim)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(id > 0, ESP_ERR_INVALID_ARG, err, TAG, "cannot set bandwidth: invalid id provided (id=%" PRIi8 ")", id);
+    ESP_GOTO_ON_FALSE(bw_lim > 0, ESP_ERR_INVALID_ARG, err, TAG, "cannot set bandwidth: invalid bandwidth %" PRIi32, bw_lim);
+    iperf_instance_data_t *iperf_instance = iperf_list_get_instance_by_id(id);
+    ESP_GOTO_ON_FALSE(iperf_instance != NULL, ESP_ERR_INVALID_STATE, err, TAG, "cannot set bandwidth: instance (id=%" PRIi8 ") was not found", id);
+    ret = iperf_set_tx_bandwidth(iperf_instance, bw_lim);
+err:
+    return ret;
+}
+
+esp_err_t iperf_restart_instance(iperf_id_t id, const iperf_cfg_t *cfg)
+{
+    esp_err_t ret = ESP_OK;
+    const uint32_t fixed_flags = IPERF_FLAG_CLIENT | IPERF_FLAG_SERVER | IPERF_FLAG_TCP | IPERF_FLAG_UDP;
+    ESP_GOTO_ON_FALSE(id > 0, ESP_ERR_INVALID_ARG, err, TAG, "cannot restart instance: invalid id provided (id=%" PRIi8 ")", id);
+    ESP_GOTO_ON_FALSE(cfg == NULL || (cfg->tos >= 0 && cfg->tos <= 255), ESP_ERR_INVALID_ARG, err, TAG, "Invalid TOS value, should be in range 0x00~0xFF");
+    iperf_instance_data_t *iperf_instance = iperf_list_get_instance_by_id(id);
+    ESP_GOTO_ON_FALSE(iperf_instance != NULL, ESP_ERR_INVALID_STATE, err, TAG, "cannot restart instance: instance (id=%" PRIi8 ") was not found", id);
+    ESP_GOTO_ON_FALSE(atomic_load(&iperf_instance->parked) && !atomic_load(&iperf_instance->release), ESP_ERR_INVALID_STATE, err, TAG_ID,
+                      "cannot restart instance: instance is not parked");
+    if (cfg != NULL) {
+        ESP_GOTO_ON_FALSE((cfg->flag & fixed_flags) == (iperf_instance->flags & fixed_flags) &&
+                          iperf_get_transport(cfg->transport) == iperf_instance->transport, ESP_ERR_INVALID_ARG, err, TAG_ID,
+                          "cannot restart instance: role, protocol and transport are those of the start");
+    }
+
+    // reset the counters of the last run
+    iperf_output_format_t output_format = iperf_instance->traffic.output_format;
+    memset(&iperf_instance->traffic, 0, sizeof(iperf_traffic_report_t));
+    iperf_instance->traffic.output_format = output_format;
+    iperf_report_task_data_t report_task_data = { 0 };
+    atomic_store(&iperf_instance->report_task_data, report_task_data);
+    atomic_store(&iperf_instance->period_data_passed, 0);
+    atomic_store(&iperf_instance->traffic_finished, false);
+    atomic_store(&iperf_instance->session_end, false);
+    iperf_instance->timers.ticks = 0;
+    iperf_instance->timers.to_report_ticks = 0;
+    memset(&iperf_instance->udp_rx_stats, 0, sizeof(iperf_udp_rx_stats_t));
+    memset(&iperf_instance->transport_stats, 0, sizeof(iperf_transport_stats_t));
+    iperf_instance->udp_tx_datagrams = 0;
+    iperf_instance->rr_transactions = 0;
+    iperf_instance->crr_connections = 0;
+    iperf_instance->crr_failures = 0;
+    memset(&iperf_instance->rtt, 0, sizeof(iperf_rtt_stats_t));
+    memset(&iperf_instance->connect_time, 0, sizeof(iperf_rtt_stats_t));
+    if (iperf_instance->rtt_hist) {
+        memset(iperf_instance->rtt_hist, 0, sizeof(iperf_rtt_hist_t));
+    }
+    if (iperf_instance->connect_hist) {
+        memset(iperf_instance->connect_hist, 0, sizeof(iperf_rtt_hist_t));
+    }
+    iperf_instance->verify.verified_bytes = 0;
+    iperf_instance->verify.corrupt_bytes = 0;
+    iperf_instance->verify.corrupt_segments = 0;
+    memset(&iperf_instance->file_stats, 0, sizeof(iperf_file_stats_t));
+    iperf_isoch_reset(iperf_instance);
+    memset(&iperf_instance->trace.stats, 0, sizeof(iperf_trace_stats_t));
+    memset(&iperf_instance->load.stats, 0, sizeof(iperf_load_stats_t));
+    iperf_instance->backoff.delay_ms = 0;
+    atomic_store(&iperf_instance->backoff.failed_sends, 0);
+    atomic_store(&iperf_instance->backoff.failed_bytes, 0);
+    atomic_store(&iperf_instance->backoff.wait_us, 0);
+    atomic_store(&iperf_instance->load.duty_percent, iperf_instance->load.cfg.duty_percent);
+    iperf_instance->load.step = 1;
+    iperf_instance->load.step_start_sec = 0;
+    iperf_instance->load.step_start_bytes = 0;
+    iperf_instance->cpu_time_us = 0;
+    iperf_instance->start_latency_us = 0;
+
+    if (cfg != NULL) {
+        bool is_paced = iperf_instance->timers.tx_timer != NULL;
+        ESP_GOTO_ON_ERROR(iperf_apply_run_cfg(iperf_instance, cfg), err, TAG_ID, "cannot restart instance: failed to apply config");
+        if (is_paced != (iperf_instance->timers.tx_period_us > 0 || iperf_instance->timers.tx_oneshot) ||
+                iperf_instance->timers.tick_timer == NULL) {
+            // the Tx timer exists only for a bandwidth limit or a trace
+            iperf_delete_timers(iperf_instance);
+            ESP_GOTO_ON_ERROR(iperf_create_timers(iperf_instance), err, TAG_ID, "failed to create timers");
+        }
+    } else {
+        // the last configuration: the ramp starts over at the configured bandwidth, also after bandwidth changes
+        iperf_instance->ramp.step = iperf_instance->ramp.cfg.step_sec != 0 ? 1 : 0;
+        iperf_instance->ramp.step_start_sec = 0;
+        iperf_instance->ramp.step_start_bytes = 0;
+        iperf_instance->bw_lim = iperf_instance->start_bw_lim;
+        iperf_instance->timers.tx_period_us = iperf_instance->timers.start_tx_period_us;
+        if (iperf_instance->isoch.cfg.fps) {
+            iperf_instance->isoch.cfg.mean_bw = iperf_instance->start_bw_lim;
+        }
+    }
+
+    iperf_instance->start_us = esp_timer_get_time();
+    iperf_instance->is_running = true;
+    atomic_store(&iperf_instance->parked, false);
+    xTaskNotifyGive(iperf_instance->traffic_task_hdl);
+err:
+    return ret;
+}
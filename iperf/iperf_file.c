@@ -0,0 +1,567 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * File payload source of a client (iperf_cfg_t.file_path).
+ *
+ * The file is sent from its start, at its end it starts over until the test ends.
+ * - linux target: the file is mapped, data is sent straight from the mapping. Its pages are touched before the send
+ *   so that reading the file is accounted as file time, not as send time.
+ * - other targets: a reader task keeps CONFIG_IPERF_FILE_READ_AHEAD_CHUNKS chunks of the file read ahead, so that
+ *   reading from flash or SD card overlaps with sending.
+ *
+ * File sink of a server (iperf_cfg_t.write_path).
+ *
+ * Data is received into one of two blocks while a writer task writes the other one to the file.
+ *
+ * Trace of a replaying client (iperf_cfg_t.trace_path).
+ *
+ * The whole trace is in memory before the replay starts: mapped and read in on linux, read into a buffer on other
+ * targets. Records are checked once when the trace is opened, the replay only byte swaps them.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "iperf.h"
+#include "iperf_private.h"
+
+#if IPERF_FILE_MMAP_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+#define IPERF_FILE_PAGE_LEN         (4096)
+#define IPERF_FILE_POLL_MS          (100)
+#define IPERF_FILE_READER_STACK     (3072)
+#define IPERF_FILE_READER_NAME      "iperf_file"
+#define IPERF_FILE_CLOSE_TMO_MS     (1000)
+#define IPERF_FILE_WRITER_STACK     (3072)
+#define IPERF_FILE_WRITER_NAME      "iperf_write"
+#define IPERF_FILE_SINK_BLOCKS      (2)
+#define IPERF_FILE_WRITE_TMO_MS     (10 * 1000)  /* flushing the sink at close */
+
+#define TAG_ID iperf_instance->tag
+
+#if IPERF_FILE_MMAP_SUPPORTED
+struct iperf_file_source {
+    const uint8_t *map;
+    size_t size;
+    size_t offset;  /* of the next chunk */
+    uint32_t chunk_len;
+};
+
+esp_err_t iperf_file_open(iperf_instance_data_t *iperf_instance, uint32_t chunk_len)
+{
+    esp_err_t ret = ESP_OK;
+    struct stat st;
+
+    iperf_file_source_t *file = calloc(1, sizeof(iperf_file_source_t));
+    ESP_RETURN_ON_FALSE(file, ESP_ERR_NO_MEM, TAG_ID, "cannot open payload file: not enough memory");
+    file->chunk_len = chunk_len;
+    int fd = open(iperf_instance->file_path, O_RDONLY);
+    ESP_GOTO_ON_FALSE(fd >= 0, ESP_FAIL, err, TAG_ID, "cannot open payload file %s - errno %d", iperf_instance->file_path, errno);
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        ESP_GOTO_ON_FALSE(false, ESP_FAIL, err, TAG_ID, "payload file %s is empty or not readable", iperf_instance->file_path);
+    }
+    file->size = st.st_size;
+    void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file referenced
+    close(fd);
+    ESP_GOTO_ON_FALSE(map != MAP_FAILED, ESP_FAIL, err, TAG_ID, "cannot map payload file - errno %d", errno);
+    madvise(map, file->size, MADV_SEQUENTIAL);
+    file->map = map;
+    iperf_instance->file = file;
+    ESP_LOGD(TAG_ID, "payload file %s mapped, %zu bytes", iperf_instance->file_path, file->size);
+    return ESP_OK;
+err:
+    free(file);
+    return ret;
+}
+
+const uint8_t *iperf_file_next(iperf_instance_data_t *iperf_instance, uint32_t max_len, uint32_t *len)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+    const uint8_t *data = file->map + file->offset;
+    volatile uint8_t touch;
+
+    *len = MIN(MIN(max_len, file->chunk_len), file->size - file->offset);
+    // fault the pages in here, so that reading the file is not hidden in the send call
+    for (uint32_t pos = 0; pos < *len; pos += IPERF_FILE_PAGE_LEN) {
+        touch = data[pos];
+    }
+    (void)touch;
+    return data;
+}
+
+void iperf_file_release(iperf_instance_data_t *iperf_instance, uint32_t len)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+
+    file->offset += len;
+    if (file->offset >= file->size) {
+        file->offset = 0;
+    }
+}
+
+void iperf_file_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+
+    if (file == NULL) {
+        return;
+    }
+    munmap((void *)file->map, file->size);
+    free(file);
+    iperf_instance->file = NULL;
+}
+
+#else // IPERF_FILE_MMAP_SUPPORTED
+
+struct iperf_file_source {
+    FILE *fp;
+    uint8_t *chunks;  /* CONFIG_IPERF_FILE_READ_AHEAD_CHUNKS chunks of chunk_len bytes */
+    uint32_t chunk_len;
+    QueueHandle_t free_chunks;  /* chunks to be read into, pointers */
+    QueueHandle_t read_chunks;  /* chunks to be sent, in file order */
+    uint8_t *chunk;  /* chunk being sent */
+    uint32_t chunk_pos;  /* of the next data within the chunk */
+    _Atomic bool stop;
+    _Atomic bool failed;
+    _Atomic bool reader_exited;
+    char *tag;
+};
+
+/* fill a chunk from the file, starting over at its end */
+static bool iperf_file_read_chunk(iperf_file_source_t *file, uint8_t *chunk)
+{
+    uint32_t filled = 0;
+    bool rewound = false;
+
+    while (filled < file->chunk_len) {
+        size_t n = fread(chunk + filled, 1, file->chunk_len - filled, file->fp);
+        if (n == 0) {
+            // the end of an empty or unreadable file is reached without any data since the last rewind
+            if (ferror(file->fp) || rewound) {
+                return false;
+            }
+            rewind(file->fp);
+            rewound = true;
+            continue;
+        }
+        filled += n;
+        rewound = false;
+    }
+    return true;
+}
+
+static void iperf_file_reader_task(void *arg)
+{
+    iperf_file_source_t *file = (iperf_file_source_t *)arg;
+    uint8_t *chunk;
+
+    while (!atomic_load(&file->stop)) {
+        if (xQueueReceive(file->free_chunks, &chunk, pdMS_TO_TICKS(IPERF_FILE_POLL_MS)) != pdTRUE) {
+            continue;
+        }
+        if (!iperf_file_read_chunk(file, chunk)) {
+            ESP_LOGE(file->tag, "failed to read payload file - errno %d", errno);
+            atomic_store(&file->failed, true);
+            break;
+        }
+        xQueueSend(file->read_chunks, &chunk, portMAX_DELAY);
+    }
+    atomic_store(&file->reader_exited, true);
+    vTaskDelete(NULL);
+}
+
+static void iperf_file_free(iperf_file_source_t *file)
+{
+    if (file->fp) {
+        fclose(file->fp);
+    }
+    if (file->free_chunks) {
+        vQueueDelete(file->free_chunks);
+    }
+    if (file->read_chunks) {
+        vQueueDelete(file->read_chunks);
+    }
+    free(file->chunks);
+    free(file);
+}
+
+esp_err_t iperf_file_open(iperf_instance_data_t *iperf_instance, uint32_t chunk_len)
+{
+    esp_err_t ret = ESP_OK;
+    const uint32_t chunks = CONFIG_IPERF_FILE_READ_AHEAD_CHUNKS;
+
+    iperf_file_source_t *file = calloc(1, sizeof(iperf_file_source_t));
+    ESP_RETURN_ON_FALSE(file, ESP_ERR_NO_MEM, TAG_ID, "cannot open payload file: not enough memory");
+    file->chunk_len = chunk_len;
+    file->tag = iperf_instance->tag;
+    file->fp = fopen(iperf_instance->file_path, "rb");
+    ESP_GOTO_ON_FALSE(file->fp, ESP_FAIL, err, TAG_ID, "cannot open payload file %s - errno %d", iperf_instance->file_path, errno);
+    file->chunks = malloc(chunks * chunk_len);
+    file->free_chunks = xQueueCreate(chunks, sizeof(uint8_t *));
+    file->read_chunks = xQueueCreate(chunks, sizeof(uint8_t *));
+    ESP_GOTO_ON_FALSE(file->chunks && file->free_chunks && file->read_chunks, ESP_ERR_NO_MEM, err, TAG_ID,
+                      "cannot open payload file: not enough memory for read-ahead");
+    for (uint32_t i = 0; i < chunks; i++) {
+        uint8_t *chunk = file->chunks + i * chunk_len;
+        xQueueSend(file->free_chunks, &chunk, 0);
+    }
+    // the reader runs at the priority of the traffic task, which blocks while waiting for data or the network
+    ESP_GOTO_ON_FALSE(xTaskCreate(iperf_file_reader_task, IPERF_FILE_READER_NAME, IPERF_FILE_READER_STACK, file,
+                                  uxTaskPriorityGet(NULL), NULL) == pdPASS, ESP_ERR_NO_MEM, err, TAG_ID,
+                      "cannot create payload file reader task");
+    iperf_instance->file = file;
+    return ESP_OK;
+err:
+    iperf_file_free(file);
+    return ret;
+}
+
+const uint8_t *iperf_file_next(iperf_instance_data_t *iperf_instance, uint32_t max_len, uint32_t *len)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+
+    while (file->chunk == NULL) {
+        if (xQueueReceive(file->read_chunks, &file->chunk, pdMS_TO_TICKS(IPERF_FILE_POLL_MS)) == pdTRUE) {
+            file->chunk_pos = 0;
+            break;
+        }
+        if (atomic_load(&file->failed) || !iperf_instance->is_running) {
+            return NULL;
+        }
+    }
+    *len = MIN(max_len, file->chunk_len - file->chunk_pos);
+    return file->chunk + file->chunk_pos;
+}
+
+void iperf_file_release(iperf_instance_data_t *iperf_instance, uint32_t len)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+
+    file->chunk_pos += len;
+    if (file->chunk_pos >= file->chunk_len) {
+        xQueueSend(file->free_chunks, &file->chunk, 0);
+        file->chunk = NULL;
+    }
+}
+
+void iperf_file_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_file_source_t *file = iperf_instance->file;
+
+    if (file == NULL) {
+        return;
+    }
+    atomic_store(&file->stop, true);
+    // the reader may wait for a free chunk, or to queue a read one
+    for (int tmo = 0; !atomic_load(&file->reader_exited) && tmo < IPERF_FILE_CLOSE_TMO_MS; tmo += 10) {
+        uint8_t *chunk;
+        while (xQueueReceive(file->read_chunks, &chunk, 0) == pdTRUE) {
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (!atomic_load(&file->reader_exited)) {
+        // leaked rather than freed under the reader
+        ESP_LOGE(TAG_ID, "payload file reader hanged, its resources are not released");
+    } else {
+        iperf_file_free(file);
+    }
+    iperf_instance->file = NULL;
+}
+
+#endif // IPERF_FILE_MMAP_SUPPORTED
+
+/*************************************************
+ * File sink
+ *************************************************/
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+} iperf_file_block_t;
+
+struct iperf_file_sink {
+    int fd;
+    iperf_file_block_t blocks[IPERF_FILE_SINK_BLOCKS];
+    uint32_t block_len;
+    iperf_file_block_t *block;  /* being received into */
+    QueueHandle_t free_blocks;  /* pointers to blocks */
+    QueueHandle_t full_blocks;  /* blocks to be written, in receive order */
+    _Atomic bool stop;
+    _Atomic bool failed;
+    _Atomic bool writer_exited;
+    char *tag;
+};
+
+static bool iperf_file_write_all(int fd, const uint8_t *data, uint32_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void iperf_file_writer_task(void *arg)
+{
+    iperf_file_sink_t *sink = (iperf_file_sink_t *)arg;
+    iperf_file_block_t *block;
+
+    while (true) {
+        if (xQueueReceive(sink->full_blocks, &block, pdMS_TO_TICKS(IPERF_FILE_POLL_MS)) != pdTRUE) {
+            // stopped once all queued blocks are written
+            if (atomic_load(&sink->stop)) {
+                break;
+            }
+            continue;
+        }
+        if (!atomic_load(&sink->failed) && !iperf_file_write_all(sink->fd, block->data, block->len)) {
+            ESP_LOGE(sink->tag, "failed to write received data - errno %d", errno);
+            atomic_store(&sink->failed, true);
+        }
+        block->len = 0;
+        xQueueSend(sink->free_blocks, &block, portMAX_DELAY);
+    }
+    atomic_store(&sink->writer_exited, true);
+    vTaskDelete(NULL);
+}
+
+static void iperf_file_sink_free(iperf_file_sink_t *sink)
+{
+    if (sink->fd >= 0) {
+        close(sink->fd);
+    }
+    if (sink->free_blocks) {
+        vQueueDelete(sink->free_blocks);
+    }
+    if (sink->full_blocks) {
+        vQueueDelete(sink->full_blocks);
+    }
+    for (int i = 0; i < IPERF_FILE_SINK_BLOCKS; i++) {
+        free(sink->blocks[i].data);
+    }
+    free(sink);
+}
+
+esp_err_t iperf_file_sink_open(iperf_instance_data_t *iperf_instance, uint32_t block_len)
+{
+    esp_err_t ret = ESP_OK;
+
+    iperf_file_sink_t *sink = calloc(1, sizeof(iperf_file_sink_t));
+    ESP_RETURN_ON_FALSE(sink, ESP_ERR_NO_MEM, TAG_ID, "cannot open file to write: not enough memory");
+    sink->block_len = block_len;
+    sink->tag = iperf_instance->tag;
+    sink->fd = open(iperf_instance->write_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ESP_GOTO_ON_FALSE(sink->fd >= 0, ESP_FAIL, err, TAG_ID, "cannot open file %s to write - errno %d", iperf_instance->write_path, errno);
+    sink->free_blocks = xQueueCreate(IPERF_FILE_SINK_BLOCKS, sizeof(iperf_file_block_t *));
+    sink->full_blocks = xQueueCreate(IPERF_FILE_SINK_BLOCKS, sizeof(iperf_file_block_t *));
+    ESP_GOTO_ON_FALSE(sink->free_blocks && sink->full_blocks, ESP_ERR_NO_MEM, err, TAG_ID, "cannot open file to write: not enough memory");
+    for (int i = 0; i < IPERF_FILE_SINK_BLOCKS; i++) {
+        iperf_file_block_t *block = &sink->blocks[i];
+        block->data = malloc(block_len);
+        ESP_GOTO_ON_FALSE(block->data, ESP_ERR_NO_MEM, err, TAG_ID, "cannot open file to write: not enough memory for write blocks");
+        xQueueSend(sink->free_blocks, &block, 0);
+    }
+    ESP_GOTO_ON_FALSE(xTaskCreate(iperf_file_writer_task, IPERF_FILE_WRITER_NAME, IPERF_FILE_WRITER_STACK, sink,
+                                  uxTaskPriorityGet(NULL), NULL) == pdPASS, ESP_ERR_NO_MEM, err, TAG_ID,
+                      "cannot create file writer task");
+    iperf_instance->file_sink = sink;
+    return ESP_OK;
+err:
+    iperf_file_sink_free(sink);
+    return ret;
+}
+
+uint8_t *iperf_file_sink_buffer(iperf_instance_data_t *iperf_instance, uint32_t min_len, uint32_t *len)
+{
+    iperf_file_sink_t *sink = iperf_instance->file_sink;
+
+    if (sink->block != NULL && sink->block_len - sink->block->len < min_len) {
+        // the next receive would not fit, the block is written as it is
+        xQueueSend(sink->full_blocks, &sink->block, portMAX_DELAY);
+        sink->block = NULL;
+    }
+    if (sink->block == NULL) {
+        // a write stall: both blocks are being written
+        int64_t wait_start_us = esp_timer_get_time();
+        while (xQueueReceive(sink->free_blocks, &sink->block, pdMS_TO_TICKS(IPERF_FILE_POLL_MS)) != pdTRUE) {
+            if (!iperf_instance->is_running) {
+                iperf_instance->file_stats.file_wait_us += esp_timer_get_time() - wait_start_us;
+                return NULL;
+            }
+        }
+        iperf_instance->file_stats.file_wait_us += esp_timer_get_time() - wait_start_us;
+    }
+    if (atomic_load(&sink->failed)) {
+        return NULL;
+    }
+    *len = sink->block_len - sink->block->len;
+    return sink->block->data + sink->block->len;
+}
+
+void iperf_file_sink_commit(iperf_instance_data_t *iperf_instance, uint32_t len)
+{
+    iperf_file_sink_t *sink = iperf_instance->file_sink;
+
+    sink->block->len += len;
+    iperf_instance->file_stats.write_bytes += len;
+    if (sink->block->len >= sink->block_len) {
+        xQueueSend(sink->full_blocks, &sink->block, portMAX_DELAY);
+        sink->block = NULL;
+    }
+}
+
+void iperf_file_sink_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_file_sink_t *sink = iperf_instance->file_sink;
+
+    if (sink == NULL) {
+        return;
+    }
+    if (sink->block != NULL && sink->block->len > 0) {
+        xQueueSend(sink->full_blocks, &sink->block, portMAX_DELAY);
+        sink->block = NULL;
+    }
+    atomic_store(&sink->stop, true);
+    for (int tmo = 0; !atomic_load(&sink->writer_exited) && tmo < IPERF_FILE_WRITE_TMO_MS; tmo += 10) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (!atomic_load(&sink->writer_exited)) {
+        // leaked rather than freed under the writer
+        ESP_LOGE(TAG_ID, "file writer hanged, its resources are not released");
+    } else {
+        iperf_file_sink_free(sink);
+    }
+    iperf_instance->file_sink = NULL;
+}
+
+/*************************************************
+ * Trace
+ *************************************************/
+esp_err_t iperf_trace_open(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    iperf_trace_t *trace = &iperf_instance->trace;
+    const char *path = iperf_instance->trace_path;
+    iperf_trace_file_hdr_t hdr;
+    struct stat st;
+
+    int fd = open(path, O_RDONLY);
+    ESP_RETURN_ON_FALSE(fd >= 0, ESP_FAIL, TAG_ID, "cannot open trace %s - errno %d", path, errno);
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hdr) + sizeof(iperf_trace_record_t)) {
+        close(fd);
+        ESP_RETURN_ON_FALSE(false, ESP_FAIL, TAG_ID, "trace %s is too short or not readable", path);
+    }
+    trace->mem_size = st.st_size;
+#if IPERF_FILE_MMAP_SUPPORTED
+    // read in at once, page faults would show as replay timing errors
+    void *map = mmap(NULL, trace->mem_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    ESP_RETURN_ON_FALSE(map != MAP_FAILED, ESP_FAIL, TAG_ID, "cannot map trace - errno %d", errno);
+    trace->mem = map;
+#else
+    if (trace->mem_size > CONFIG_IPERF_TRACE_MAX_LEN) {
+        close(fd);
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_SIZE, TAG_ID, "trace %s of %zu bytes is too large, the limit is %d bytes (CONFIG_IPERF_TRACE_MAX_LEN)",
+                            path, trace->mem_size, CONFIG_IPERF_TRACE_MAX_LEN);
+    }
+    trace->mem = malloc(trace->mem_size);
+    if (trace->mem == NULL) {
+        close(fd);
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_NO_MEM, TAG_ID, "trace %s of %zu bytes is too large for the heap", path, trace->mem_size);
+    }
+    size_t done = 0;
+    while (done < trace->mem_size) {
+        ssize_t len = read(fd, (uint8_t *)trace->mem + done, trace->mem_size - done);
+        if (len <= 0) {
+            break;
+        }
+        done += len;
+    }
+    close(fd);
+    ESP_GOTO_ON_FALSE(done == trace->mem_size, ESP_FAIL, err, TAG_ID, "cannot read trace - errno %d", errno);
+#endif
+
+    memcpy(&hdr, trace->mem, sizeof(hdr));
+    uint32_t count = ntohl(hdr.records);
+    ESP_GOTO_ON_FALSE(ntohl(hdr.magic) == IPERF_TRACE_MAGIC && count > 0 &&
+                      (trace->mem_size - sizeof(hdr)) / sizeof(iperf_trace_record_t) >= count,
+                      ESP_FAIL, err, TAG_ID, "%s is not a trace or is truncated", path);
+    const iperf_trace_record_t *records = (const iperf_trace_record_t *)((const uint8_t *)trace->mem + sizeof(hdr));
+    uint32_t first_us = ntohl(records[0].offset_us);
+    uint32_t prev_us = first_us;
+    uint32_t long_cnt = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t offset_us = ntohl(records[i].offset_us);
+        ESP_GOTO_ON_FALSE(offset_us >= prev_us, ESP_FAIL, err, TAG_ID, "trace record %" PRIu32 " is sent before the previous one", i);
+        prev_us = offset_us;
+        long_cnt += ntohs(records[i].len) > iperf_instance->socket_info.buffer_len;
+    }
+    // a loop of a single send time would be sent unpaced
+    ESP_GOTO_ON_FALSE(!trace->loop || prev_us > first_us, ESP_ERR_INVALID_ARG, err, TAG_ID,
+                      "trace %s has a single send time, it cannot be looped", path);
+    if (long_cnt) {
+        ESP_LOGW(TAG_ID, "%" PRIu32 " datagrams of the trace are longer than %" PRIu32 " bytes (-l), they are sent truncated",
+                 long_cnt, iperf_instance->socket_info.buffer_len);
+    }
+    if (trace->error_hist == NULL) {
+        trace->error_hist = calloc(1, sizeof(iperf_rtt_hist_t));
+        if (trace->error_hist == NULL) {
+            ESP_LOGW(TAG_ID, "not enough memory for replay timing errors, only datagrams are counted");
+        }
+    }
+    trace->records = records;
+    trace->count = count;
+    trace->first_offset_us = first_us;
+    // a loop starts over after the mean gap, a looped trace has at least two send times
+    uint32_t span_us = prev_us - first_us;
+    trace->duration_us = trace->loop ? span_us + span_us / (count - 1) : span_us;
+    ESP_LOGD(TAG_ID, "trace %s loaded, %" PRIu32 " datagrams in %" PRIu32 " us", path, count, span_us);
+    return ESP_OK;
+err:
+    iperf_trace_close(iperf_instance);
+    return ret;
+}
+
+void iperf_trace_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_trace_t *trace = &iperf_instance->trace;
+
+    if (trace->mem == NULL) {
+        return;
+    }
+#if IPERF_FILE_MMAP_SUPPORTED
+    munmap(trace->mem, trace->mem_size);
+#else
+    free(trace->mem);
+#endif
+    trace->mem = NULL;
+    trace->records = NULL;
+    trace->count = 0;
+}
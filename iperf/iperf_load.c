@@ -0,0 +1,159 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * CPU and memory load co-runner of an instance (iperf_cfg_t.load).
+ *
+ * A load task runs while the traffic loop runs. It is busy for duty_percent of every IPERF_LOAD_WINDOW_MS window and
+ * blocks for the rest of it, at least a tick of every window is left to lower priority tasks (idle task, task watchdog).
+ * It blocks on its task notification, so that stopping wakes it at once.
+ * Busy time either spins, or copies between the halves of a buffer of mem_len bytes allocated in PSRAM if there is
+ * some, so that the load competes for the memory bus as well.
+ * With load steps the report task raises the duty cycle, throughput of every load level is reported separately.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "iperf.h"
+#include "iperf_private.h"
+
+#define IPERF_LOAD_TASK_STACK       (2048)
+#define IPERF_LOAD_TASK_NAME        "iperf_load"
+#define IPERF_LOAD_COPY_LEN         (4096)  /* bytes copied between two checks of the time */
+#define IPERF_LOAD_SPIN_LOOPS       (1000)  /* spins between two checks of the time */
+
+#define TAG_ID iperf_instance->tag
+
+struct iperf_load_runner {
+    _Atomic uint8_t *duty_percent;  /* of the instance, raised by the report task */
+    uint8_t *mem;  /* NULL to spin */
+    uint32_t half_len;  /* copied from the first half of mem to the second one */
+    uint32_t offset;  /* of the next copy within the half */
+    _Atomic bool stop;
+    TaskHandle_t task;
+    SemaphoreHandle_t exited;  /* given by the load task before it deletes itself */
+    StaticSemaphore_t exited_buf;
+    uint64_t busy_wall_us;
+    uint64_t mem_bytes;
+};
+
+static void iperf_load_busy(iperf_load_runner_t *runner, int64_t until_us)
+{
+    volatile uint32_t spin = 0;
+
+    while (esp_timer_get_time() < until_us && !atomic_load(&runner->stop)) {
+        if (runner->mem) {
+            uint32_t len = MIN(IPERF_LOAD_COPY_LEN, runner->half_len - runner->offset);
+            memcpy(runner->mem + runner->half_len + runner->offset, runner->mem + runner->offset, len);
+            runner->offset += len;
+            if (runner->offset == runner->half_len) {
+                runner->offset = 0;
+            }
+            runner->mem_bytes += len;
+        } else {
+            for (int i = 0; i < IPERF_LOAD_SPIN_LOOPS; i++) {
+                spin++;
+            }
+        }
+    }
+}
+
+static void iperf_load_task(void *arg)
+{
+    iperf_load_runner_t *runner = (iperf_load_runner_t *)arg;
+    const int64_t window_us = IPERF_LOAD_WINDOW_MS * 1000LL;
+    const int64_t max_busy_us = window_us - portTICK_PERIOD_MS * 1000LL;
+    int64_t window_start_us = esp_timer_get_time();
+
+    while (!atomic_load(&runner->stop)) {
+        int64_t busy_us = MIN(window_us * atomic_load(runner->duty_percent) / 100, max_busy_us);
+        if (busy_us > 0) {
+            int64_t start = esp_timer_get_time();
+            iperf_load_busy(runner, start + busy_us);
+            runner->busy_wall_us += esp_timer_get_time() - start;
+        }
+        // the window is kept even if the task was preempted while busy, unless it is over already
+        window_start_us += window_us;
+        int64_t now_us = esp_timer_get_time();
+        if (window_start_us < now_us) {
+            window_start_us = now_us;
+        }
+        ulTaskNotifyTake(pdTRUE, MAX(pdMS_TO_TICKS((window_start_us - now_us) / 1000), 1));
+    }
+    xSemaphoreGive(runner->exited);
+    vTaskDelete(NULL);
+}
+
+static void iperf_load_free(iperf_load_runner_t *runner)
+{
+    vSemaphoreDelete(runner->exited);
+    free(runner->mem);
+    free(runner);
+}
+
+esp_err_t iperf_load_start(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    iperf_load_t *load = &iperf_instance->load;
+
+    if (!load->is_active) {
+        return ESP_OK;
+    }
+    iperf_load_runner_t *runner = calloc(1, sizeof(iperf_load_runner_t));
+    ESP_RETURN_ON_FALSE(runner, ESP_ERR_NO_MEM, TAG_ID, "cannot start load: not enough memory");
+    runner->duty_percent = &load->duty_percent;
+    runner->exited = xSemaphoreCreateBinaryStatic(&runner->exited_buf);
+    if (load->cfg.mem_len != 0) {
+        runner->mem = heap_caps_malloc(load->cfg.mem_len, MALLOC_CAP_SPIRAM);
+        if (runner->mem == NULL) {
+            runner->mem = heap_caps_malloc(load->cfg.mem_len, MALLOC_CAP_8BIT);
+            ESP_GOTO_ON_FALSE(runner->mem, ESP_ERR_NO_MEM, err, TAG_ID, "cannot start load: not enough memory for %" PRIu32 " bytes",
+                              load->cfg.mem_len);
+            ESP_LOGW(TAG_ID, "no PSRAM for the load buffer, internal memory is copied");
+        }
+        memset(runner->mem, 0x5a, load->cfg.mem_len);
+        runner->half_len = load->cfg.mem_len / 2;
+    }
+    // by default at the priority of the traffic task, so that they share its core by time slices
+    UBaseType_t priority = load->cfg.priority ? load->cfg.priority : uxTaskPriorityGet(NULL);
+    BaseType_t core = load->cfg.core < 0 ? tskNO_AFFINITY : load->cfg.core;
+    ESP_GOTO_ON_FALSE(xTaskCreatePinnedToCore(iperf_load_task, IPERF_LOAD_TASK_NAME, IPERF_LOAD_TASK_STACK, runner,
+                                              priority, &runner->task, core) == pdPASS, ESP_ERR_NO_MEM, err, TAG_ID,
+                      "cannot create load task");
+    load->runner = runner;
+    return ESP_OK;
+err:
+    iperf_load_free(runner);
+    return ret;
+}
+
+void iperf_load_stop(iperf_instance_data_t *iperf_instance)
+{
+    iperf_load_t *load = &iperf_instance->load;
+    iperf_load_runner_t *runner = load->runner;
+
+    if (runner == NULL) {
+        return;
+    }
+    atomic_store(&runner->stop, true);
+    xTaskNotifyGive(runner->task);
+    // the load task blocks at least a tick of every window, it gets to exit even at a higher priority
+    xSemaphoreTake(runner->exited, portMAX_DELAY);
+    load->stats.busy_wall_us = runner->busy_wall_us;
+    load->stats.mem_bytes = runner->mem_bytes;
+    iperf_load_free(runner);
+    load->stats.duty_percent = atomic_load(&load->duty_percent);
+    load->runner = NULL;
+}
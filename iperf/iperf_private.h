@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2025-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -8,6 +8,7 @@
 #include <stdatomic.h>
 #include <inttypes.h>
 #include <sys/queue.h>
+#include <sys/socket.h>
 #include "sdkconfig.h"
 #include "esp_timer.h"
 #include "esp_log.h"
@@ -54,6 +55,27 @@ extern "C" {
  *************************************************/
 #define TAG_ID_STR "iperf(id=%" PRIi8 ")"
 
+/* lwIP netconn transport, see iperf_transport_netconn.c */
+#if defined(LWIP_SOCKET) && LWIP_SOCKET
+#define IPERF_NETCONN_SUPPORTED         1
+#else
+#define IPERF_NETCONN_SUPPORTED         0
+#endif
+
+/* in-memory transport, see linux_port/iperf_transport_mem.c */
+#if CONFIG_IDF_TARGET_LINUX
+#define IPERF_MEMORY_TRANSPORT_SUPPORTED    1
+#else
+#define IPERF_MEMORY_TRANSPORT_SUPPORTED    0
+#endif
+
+/* file payload source sent from a memory mapping, see iperf_file.c */
+#if CONFIG_IDF_TARGET_LINUX && __has_include(<sys/mman.h>)
+#define IPERF_FILE_MMAP_SUPPORTED       1
+#else
+#define IPERF_FILE_MMAP_SUPPORTED       0
+#endif
+
 /*************************************************
  * Structures
  *************************************************/
@@ -72,10 +94,18 @@ typedef struct {
     esp_timer_handle_t tx_timer;
     esp_timer_handle_t tick_timer;
     uint64_t tx_period_us;
+    uint64_t start_tx_period_us;  /* tx_period_us of the configuration, before ramp steps or bandwidth changes */
+    bool tx_oneshot;  /* the traffic loop starts the Tx timer for each wait, it is not periodic */
     uint32_t ticks;
     uint32_t to_report_ticks;
 } iperf_timers_t;
 
+/* socket tuning options, bits of iperf_socket_info_t.tuning_warned */
+#define IPERF_TUNING_SNDBUF     (1 << 0)
+#define IPERF_TUNING_RCVBUF     (1 << 1)
+#define IPERF_TUNING_NODELAY    (1 << 2)
+#define IPERF_TUNING_MSS        (1 << 3)
+
 typedef struct {
     esp_ip_addr_t destination;
     esp_ip_addr_t source;
@@ -83,11 +113,231 @@ typedef struct {
     uint16_t dport;
     uint16_t sport;
     int tos;  /* setsockopt does not accept uint8 size */
+    int sndbuf_len;  /* SO_SNDBUF, 0 for the default or if the socket layer refused it */
+    int rcvbuf_len;  /* SO_RCVBUF, 0 for the default or if the socket layer refused it */
+    int mss;  /* TCP_MAXSEG, 0 for the default or if the socket layer refused it */
+    int sndbuf_applied;  /* SO_SNDBUF read back from the socket layer, 0 if not set or refused */
+    int rcvbuf_applied;  /* SO_RCVBUF read back from the socket layer, 0 if not set or refused */
+    uint8_t tuning_warned;  /* IPERF_TUNING_* refused by the socket layer and warned about, kept over runs of the instance */
     uint8_t *buffer;
-    uint32_t buffer_len;
+    uint32_t buffer_size;  /* allocated bytes, a warm instance keeps its buffer unless a run needs a longer one */
+    uint32_t buffer_len;  /* length of one send/recv, for UDP client: datagram length */
+    uint32_t iov_count;  /* TCP client: iovecs per send, >1 for gathered sends which all reference the buffer */
 } iperf_socket_info_t;
 
-typedef struct iperf_instance_data_struct {
+/*
+ * UDP server statistics, only modified by the traffic task.
+ * On a UDP client they hold the statistics reported back by the server at the end of the test.
+ * The atomic counters are read by the report task.
+ */
+typedef struct {
+    _Atomic uint32_t datagrams;
+    _Atomic uint32_t lost;  /* derived from gaps in datagram sequence numbers */
+    _Atomic uint32_t out_of_order;
+    int32_t next_id;  /* next expected sequence number */
+    /* the same counters for the current client only, reported back to it when its final datagram arrives */
+    uint32_t run_datagrams;
+    uint32_t run_lost;
+    uint32_t run_out_of_order;
+    uint64_t run_bytes;
+    int64_t run_start_us;
+    int32_t fin_id;  /* negative id of the client's final datagram, 0 while the client is sending */
+    /* interarrival jitter of the current client (RFC 3550), from datagrams carrying their send time */
+    _Atomic uint32_t jitter_q4;  /* in 1/16 us */
+    uint32_t stamped;  /* datagrams carrying their send time */
+    int64_t transit_us;  /* of the last of them, including the clock offset of the client */
+    bool fin_reply;  /* a final datagram is to be answered */
+} iperf_udp_rx_stats_t;
+
+/*
+ * UDP end of test exchange, iperf2 (2.0.10 and later) layout in network byte order:
+ * the client repeats its final datagram (negative sequence number) until the server answers with its statistics.
+ */
+typedef struct {
+    int32_t id;
+    uint32_t tv_sec;
+    uint32_t tv_usec;
+    int32_t id2;
+} iperf_udp_datagram_hdr_t;
+
+typedef struct {
+    int32_t flags;
+    int32_t total_len1;  /* received bytes, upper 32 bits */
+    int32_t total_len2;  /* received bytes, lower 32 bits */
+    int32_t stop_sec;
+    int32_t stop_usec;
+    int32_t error_cnt;  /* lost datagrams */
+    int32_t outorder_cnt;
+    int32_t datagrams;
+    int32_t jitter1;
+    int32_t jitter2;
+} iperf_udp_server_report_t;
+
+/*
+ * Request/response mode, requests start with this header in network byte order (IPERF_RR_MIN_LEN bytes).
+ * The server answers with response_len bytes starting with the same header, so that a UDP client can match the response
+ * with its request and the server needs no configuration.
+ */
+typedef struct {
+    uint32_t id;  /* transaction sequence number */
+    uint16_t request_len;  /* including this header */
+    uint16_t response_len;  /* including this header */
+} iperf_rr_hdr_t;
+
+/* round trip time histogram: exact below 16 us, then 16 buckets per power of two (6% resolution) */
+#define IPERF_RTT_HIST_SUB_BITS     4
+#define IPERF_RTT_HIST_SUB_BUCKETS  (1 << IPERF_RTT_HIST_SUB_BITS)
+#define IPERF_RTT_HIST_BUCKETS      ((32 - IPERF_RTT_HIST_SUB_BITS + 1) * IPERF_RTT_HIST_SUB_BUCKETS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[IPERF_RTT_HIST_BUCKETS];
+} iperf_rtt_hist_t;
+
+/*
+ * Verify mode payload: a pattern repeated every IPERF_VERIFY_PERIOD bytes of TCP data or UDP payload (following the
+ * datagram header). Each period starts with a tag carrying the seed (client instance id), the rest is generated from it.
+ */
+#define IPERF_VERIFY_PERIOD         1024
+#define IPERF_VERIFY_TAG_LEN        4
+#define IPERF_VERIFY_UDP_HDR_LEN    sizeof(iperf_udp_datagram_hdr_t)
+
+typedef struct {
+    uint8_t *ref;  /* server: pattern of the received stream, buffer_len + IPERF_VERIFY_PERIOD bytes */
+    uint32_t ref_size;  /* allocated size of ref */
+    int16_t seed;  /* server: seed of the received stream, -1 until a tag was received */
+    uint32_t offset;  /* TCP: pattern offset of the next byte sent or received */
+    /* server: cumulative counters, written by the traffic task */
+    uint64_t verified_bytes;
+    uint64_t corrupt_bytes;
+    uint32_t corrupt_segments;
+} iperf_verify_t;
+
+/* bandwidth ramp, only modified by the report task */
+typedef struct {
+    iperf_ramp_cfg_t cfg;  /* step_sec is 0 when there is no ramp */
+    uint32_t step;  /* number of the current step, from 1 */
+    uint32_t step_start_sec;
+    uint64_t step_start_bytes;  /* total_transfer_bytes when the current step started */
+} iperf_ramp_t;
+
+/* UDP client: sends failed for lack of buffers and the backoff after them, written by the traffic task, read by the report task */
+#define IPERF_BACKOFF_DEFAULT_MAX_DELAY_MS  16
+
+typedef struct {
+    iperf_backoff_cfg_t cfg;  /* max_delay_ms is set */
+    uint32_t delay_ms;  /* delay after the next failure, 0 after a successful send */
+    _Atomic uint32_t failed_sends;
+    _Atomic uint64_t failed_bytes;
+    _Atomic uint64_t wait_us;
+} iperf_backoff_t;
+
+/* CPU and memory load co-runner, see iperf_load.c */
+#define IPERF_LOAD_WINDOW_MS        100  /* the load is busy for its duty cycle of every window */
+#define IPERF_LOAD_MIN_MEM_LEN      8192
+
+typedef struct iperf_load_runner iperf_load_runner_t;
+
+typedef struct {
+    iperf_load_cfg_t cfg;  /* step_sec is 0 when the load is constant */
+    bool is_active;
+    _Atomic uint8_t duty_percent;  /* current load level, raised by the report task at every step */
+    iperf_load_runner_t *runner;  /* running while the traffic loop runs */
+    iperf_load_stats_t stats;  /* written by the traffic task when the load stops */
+    /* load steps, only modified by the report task */
+    uint32_t step;  /* number of the current step, from 1 */
+    uint32_t step_start_sec;
+    uint64_t step_start_bytes;
+} iperf_load_t;
+
+/*
+ * Isochronous datagrams carry the scheduled time of their frame in the datagram header (tv_sec, tv_usec), followed by
+ * this header in network byte order. A UDP server tracks frames when the first datagram of a client carries it.
+ */
+#define IPERF_ISOCH_MAGIC           0x49534f43  /* "ISOC" */
+#define IPERF_ISOCH_HDR_LEN         (sizeof(iperf_udp_datagram_hdr_t) + sizeof(iperf_isoch_hdr_t))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t frame_id;  /* from 1 */
+    uint32_t frame_len;  /* bytes of all datagrams of the frame */
+    uint32_t fps;
+} iperf_isoch_hdr_t;
+
+typedef struct {
+    iperf_isoch_cfg_t cfg;  /* client: fps is 0 when not isochronous, mean_bw may be changed by iperf_set_tx_bandwidth() */
+    uint32_t prng;  /* client: frame size generator state */
+    bool rx_active;  /* server: the current client sends isochronous datagrams */
+    uint32_t frame_id;  /* server: frame being received, 0 for none */
+    uint32_t frame_len;
+    uint32_t frame_rx;  /* bytes of the frame received */
+    uint32_t period_us;  /* frame interval of the client */
+    iperf_rtt_hist_t *latency_hist;  /* server: allocated with the first isochronous client */
+    iperf_isoch_stats_t stats;  /* written by the traffic task */
+} iperf_isoch_t;
+
+/* traffic model of a UDP client, see iperf_traffic_model_t */
+#define IPERF_MODEL_MIN_WAIT_US     50  /* shorter waits are not timed, the datagram is sent at once */
+#define IPERF_MODEL_MAX_PHASE_MS    60000  /* longest mean burst or pause of on/off arrivals */
+
+typedef struct {
+    iperf_traffic_model_t cfg;  /* imix lengths limited to the datagram length */
+    bool is_active;  /* the client sends with the model */
+    uint32_t prng;  /* gap and length generator state */
+    uint32_t imix_weight;  /* sum of the weights of the mix, 0 for no mix */
+    uint32_t mean_len;  /* mean datagram length of the mix */
+} iperf_model_t;
+
+/* trace replay client, see iperf_trace_record_t */
+typedef struct {
+    bool loop;  /* start over at the end of the trace */
+    const iperf_trace_record_t *records;  /* loaded while the traffic loop runs, network byte order */
+    uint32_t count;
+    uint32_t first_offset_us;  /* send time of the first record, the replay starts with it */
+    uint32_t duration_us;  /* of one pass: from the first record to the last plus the mean gap */
+    void *mem;  /* mapping or buffer holding the records */
+    size_t mem_size;
+    iperf_rtt_hist_t *error_hist;  /* allocated with the first replay */
+    iperf_trace_stats_t stats;  /* written by the traffic task */
+} iperf_trace_t;
+
+typedef struct iperf_instance_data_struct iperf_instance_data_t;
+typedef struct iperf_file_source iperf_file_source_t;
+typedef struct iperf_file_sink iperf_file_sink_t;
+
+/*
+ * Transport operations, called by the traffic task unless noted otherwise.
+ * send/recv return the number of bytes transferred or -1 with errno set, like the socket calls.
+ */
+typedef struct {
+    const char *name;
+    /* create the connection or endpoint for the instance role and protocol */
+    esp_err_t (*open)(iperf_instance_data_t *iperf_instance);
+    int (*send)(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, size_t len);
+    int (*recv)(iperf_instance_data_t *iperf_instance, uint8_t *buffer, size_t len);
+    /* release everything created by open, also called if open failed */
+    void (*close)(iperf_instance_data_t *iperf_instance);
+    /* optional: add transport specific counters */
+    void (*get_stats)(iperf_instance_data_t *iperf_instance, iperf_transport_stats_t *stats);
+    /* optional: called by iperf_stop_exec() from any task to release a blocking recv,
+       transports without it must return from recv periodically */
+    void (*abort)(iperf_instance_data_t *iperf_instance);
+    /* optional: UDP server, send a datagram to the sender of the last received one */
+    int (*reply)(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, size_t len);
+    /* optional: called after the traffic loop ended, before the statistics are collected */
+    void (*finish)(iperf_instance_data_t *iperf_instance);
+    /* optional: TCP connection rate and daemon server, replace the connection by a new one (client: connect, server: accept) */
+    esp_err_t (*reconnect)(iperf_instance_data_t *iperf_instance);
+    /* optional: wait up to timeout_ms until a send may succeed, false on timeout */
+    bool (*wait_writable)(iperf_instance_data_t *iperf_instance, uint32_t timeout_ms);
+    /* optional: TCP client, send the data of iov_count iovecs at once */
+    int (*send_iov)(iperf_instance_data_t *iperf_instance, const struct iovec *iov, int iov_count);
+} iperf_transport_t;
+
+struct iperf_instance_data_struct {
     LIST_ENTRY(iperf_instance_data_struct) _list_entry;
 
     iperf_id_t id;
@@ -102,8 +352,49 @@ typedef struct iperf_instance_data_struct {
     uint32_t interval;
     uint32_t time;
 
+    const iperf_transport_t *transport;
+    void *transport_priv;  /* transport specific state */
+    iperf_transport_stats_t transport_stats;  /* written by the traffic task */
+
     int socket;
+    int listen_socket;  /* TCP server */
     iperf_socket_info_t socket_info;
+    iperf_udp_rx_stats_t udp_rx_stats;
+    uint32_t udp_tx_datagrams;  /* UDP client: datagrams sent, written by the traffic task */
+    uint16_t rr_request_len;  /* request/response client */
+    uint16_t rr_response_len;  /* request/response client */
+    uint32_t rr_transactions;  /* request/response: completed transactions, written by the traffic task */
+    iperf_rtt_hist_t *rtt_hist;  /* request/response client */
+    iperf_rtt_stats_t rtt;  /* request/response client: written by the traffic task when the loop ends */
+    uint32_t crr_connections;  /* TCP connection rate: established connections, written by the traffic task */
+    uint32_t crr_failures;  /* TCP connection rate: failed connects and transactions, written by the traffic task */
+    iperf_rtt_hist_t *connect_hist;  /* TCP connection rate client */
+    iperf_rtt_stats_t connect_time;  /* TCP connection rate client: written by the traffic task when the loop ends */
+
+    uint64_t cpu_time_us;  /* CPU time spent in the traffic loop, written by the traffic task */
+    _Atomic bool traffic_finished;  /* traffic task has left the traffic loop and stored its CPU time */
+    _Atomic bool session_end;  /* daemon server: a client finished, set by the traffic task, cleared by the report task which then notifies */
+    _Atomic bool parked;  /* warm instance: the traffic task waits for a restart */
+    _Atomic bool report_parked;  /* warm instance: the report task printed the summary and waits for the next run */
+    _Atomic bool release;  /* warm instance: stopped, parked tasks exit instead of waiting for a restart */
+    bool conn_kept;  /* warm TCP client: the connection of the last run is reused by the next one */
+    int64_t start_us;  /* time of the start or restart call */
+    uint32_t start_latency_us;  /* client: from the start or restart call to the traffic loop, written by the traffic task */
+    int32_t bw_lim;  /* paced client: current bandwidth limit in bits/s */
+    int32_t start_bw_lim;  /* paced client: bw_lim of the configuration, restored by a restart with the last configuration */
+    iperf_verify_t verify;
+    char *file_path;  /* client: payload file, NULL to send the instance buffer */
+    iperf_file_source_t *file;  /* open while the traffic loop runs */
+    char *write_path;  /* server: file received data is written to, NULL to discard it */
+    iperf_file_sink_t *file_sink;  /* open while the traffic loop runs */
+    iperf_file_stats_t file_stats;  /* written by the traffic task */
+    iperf_ramp_t ramp;
+    iperf_isoch_t isoch;
+    iperf_model_t model;  /* UDP client, only modified when the instance is not running */
+    char *trace_path;  /* UDP client: trace replayed, NULL for none */
+    iperf_trace_t trace;
+    iperf_load_t load;
+    iperf_backoff_t backoff;
 
     _Atomic uint32_t period_data_passed;
     _Atomic iperf_report_task_data_t report_task_data;
@@ -111,13 +402,44 @@ typedef struct iperf_instance_data_struct {
 
     iperf_state_handler_func_t state_handler;
     void* state_handler_priv;
-} iperf_instance_data_t;
+};
 
 
 /* internal used function */
 void iperf_state_action(iperf_state_t iperf_state, iperf_instance_data_t *iperf_instance);
 iperf_instance_data_t* iperf_list_get_instance_by_id(iperf_id_t id);
 TaskHandle_t iperf_create_report_task(iperf_instance_data_t *iperf_instance);
+/* paced client: change the Tx period to send at bw_lim bits/s */
+esp_err_t iperf_set_tx_bandwidth(iperf_instance_data_t *iperf_instance, int32_t bw_lim);
+
+/* file payload source, see iperf_file.c. Called by the traffic task */
+esp_err_t iperf_file_open(iperf_instance_data_t *iperf_instance, uint32_t chunk_len);
+/* next data of at most max_len bytes in file order, valid until released. NULL if the file cannot be read or the instance stopped */
+const uint8_t *iperf_file_next(iperf_instance_data_t *iperf_instance, uint32_t max_len, uint32_t *len);
+/* `len` bytes of the data returned by iperf_file_next() were consumed */
+void iperf_file_release(iperf_instance_data_t *iperf_instance, uint32_t len);
+void iperf_file_close(iperf_instance_data_t *iperf_instance);
+/* file sink of received data, see iperf_file.c. Called by the traffic task */
+esp_err_t iperf_file_sink_open(iperf_instance_data_t *iperf_instance, uint32_t block_len);
+/* space of at least min_len bytes to receive into, waits for a block to be written. NULL if writing failed or the instance stopped */
+uint8_t *iperf_file_sink_buffer(iperf_instance_data_t *iperf_instance, uint32_t min_len, uint32_t *len);
+/* `len` bytes were received into the space returned by iperf_file_sink_buffer() */
+void iperf_file_sink_commit(iperf_instance_data_t *iperf_instance, uint32_t len);
+/* writes the remaining data */
+void iperf_file_sink_close(iperf_instance_data_t *iperf_instance);
+/* trace of a replaying client, see iperf_file.c. Called by the traffic task */
+esp_err_t iperf_trace_open(iperf_instance_data_t *iperf_instance);
+void iperf_trace_close(iperf_instance_data_t *iperf_instance);
+/* load co-runner of the instance, see iperf_load.c. Called by the traffic task around the traffic loop */
+esp_err_t iperf_load_start(iperf_instance_data_t *iperf_instance);
+void iperf_load_stop(iperf_instance_data_t *iperf_instance);
+
+#if IPERF_NETCONN_SUPPORTED
+extern const iperf_transport_t iperf_transport_netconn;
+#endif
+#if IPERF_MEMORY_TRANSPORT_SUPPORTED
+extern const iperf_transport_t iperf_transport_memory;
+#endif
 
 #ifdef __cplusplus
 }
@@ -5,12 +5,15 @@
  */
 #include <inttypes.h>
 #include <stdio.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "iperf.h"
 #include "iperf_private.h"
 
 static const char *TAG = "iperf_report";
 
+#define IPERF_REPORT_WAIT_TRAFFIC_TMO_MS    (2000)  /* covers the UDP end of test exchange */
+
 
 inline static void iperf_copy_report(iperf_report_type_t report_type, iperf_instance_data_t *iperf_instance, iperf_report_t *report)
 {
@@ -21,9 +24,83 @@ inline static void iperf_copy_report(iperf_report_type_t report_type, iperf_inst
         report->connect_info.target_addr = iperf_instance->socket_info.target_addr;
     } else {
         memcpy(&(report->traffic), &(iperf_instance->traffic), sizeof(iperf_traffic_report_t));
+        report->traffic.show_stats = (iperf_instance->flags & IPERF_FLAG_STATS) != 0;
     }
 }
 
+/* UDP server statistics are cumulative counters of the traffic task, period values are the delta since last report */
+static void iperf_update_udp_rx_report(iperf_instance_data_t *iperf_instance)
+{
+    iperf_udp_rx_stats_t *stats = &iperf_instance->udp_rx_stats;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+    uint32_t datagrams = atomic_load(&stats->datagrams);
+    uint32_t lost = atomic_load(&stats->lost);
+
+    traffic->period_datagrams = datagrams - traffic->total_datagrams;
+    traffic->period_lost_datagrams = lost - traffic->total_lost_datagrams;
+    traffic->total_datagrams = datagrams;
+    traffic->total_lost_datagrams = lost;
+    traffic->total_out_of_order_datagrams = atomic_load(&stats->out_of_order);
+    traffic->jitter_us = atomic_load(&stats->jitter_q4) >> 4;
+}
+
+/* request/response counters are cumulative counters of the traffic task like the UDP server statistics */
+static void iperf_update_rr_report(iperf_instance_data_t *iperf_instance)
+{
+    uint32_t transactions = iperf_instance->rr_transactions;
+    uint32_t connections = iperf_instance->crr_connections;
+    uint32_t failures = iperf_instance->crr_failures;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+
+    traffic->period_transactions = transactions - traffic->total_transactions;
+    traffic->total_transactions = transactions;
+    traffic->period_connections = connections - traffic->total_connections;
+    traffic->total_connections = connections;
+    traffic->period_connect_failures = failures - traffic->total_connect_failures;
+    traffic->total_connect_failures = failures;
+}
+
+/* verify mode counters are cumulative counters of the traffic task like the UDP server statistics */
+static void iperf_update_verify_report(iperf_instance_data_t *iperf_instance)
+{
+    const iperf_verify_t *verify = &iperf_instance->verify;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+    uint64_t corrupt_bytes = verify->corrupt_bytes;
+    uint32_t corrupt_segments = verify->corrupt_segments;
+
+    traffic->period_corrupt_bytes = corrupt_bytes - traffic->total_corrupt_bytes;
+    traffic->total_corrupt_bytes = corrupt_bytes;
+    traffic->period_corrupt_segments = corrupt_segments - traffic->total_corrupt_segments;
+    traffic->total_corrupt_segments = corrupt_segments;
+    traffic->total_verified_bytes = verify->verified_bytes;
+}
+
+static void iperf_update_backoff_report(iperf_instance_data_t *iperf_instance)
+{
+    const iperf_backoff_t *backoff = &iperf_instance->backoff;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+    uint32_t failed_sends = atomic_load(&backoff->failed_sends);
+    uint64_t failed_bytes = atomic_load(&backoff->failed_bytes);
+
+    traffic->period_failed_sends = failed_sends - traffic->total_failed_sends;
+    traffic->total_failed_sends = failed_sends;
+    traffic->period_failed_bytes = failed_bytes - traffic->total_failed_bytes;
+    traffic->total_failed_bytes = failed_bytes;
+}
+
+static void iperf_print_rtt_stats(iperf_id_t instance_id, const char *name, const iperf_rtt_stats_t *rtt)
+{
+    printf("[%3d] %s min/avg/p50/p90/p99/max %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 " us",
+        instance_id,
+        name,
+        rtt->min_us,
+        rtt->avg_us,
+        rtt->p50_us,
+        rtt->p90_us,
+        rtt->p99_us,
+        rtt->max_us);
+}
+
 static void iperf_print_connect_info(const iperf_report_t *report)
 {
     iperf_id_t instance_id = report->instance_id;
@@ -68,6 +145,38 @@ static void iperf_print_traffic_header(void)
     printf("\n[ ID] Interval\t\tTransfer\tBandwidth\n");
 }
 
+/* bytes per unit of the output format, with the unit prefix and whether bytes or bits are printed */
+static double iperf_report_unit(iperf_output_format_t output_format, char *format_ch, bool *is_byte)
+{
+    double unit_bytes = 1.0;
+    switch (output_format) {
+        case BITS_PER_SEC:
+            break;
+        case KBITS_PER_SEC: /* '-f k' */
+            unit_bytes = 1000.0;
+            *format_ch = 'K';
+            break;
+        case MBITS_PER_SEC: /* '-f m' */
+            unit_bytes = 1000.0 * 1000.0;
+            *format_ch = 'M';
+            break;
+        case KBYTES_PER_SEC: /* '-f K' */
+            unit_bytes = 1024.0;
+            *format_ch = 'K';
+            *is_byte = true;
+            break;
+        case MBYTES_PER_SEC: /* '-f M' */
+            unit_bytes = 1024.0 * 1024.0;
+            *format_ch = 'M';
+            *is_byte = true;
+            break;
+        default:
+            /* should not happen */
+            break;
+    }
+    return unit_bytes;
+}
+
 static void iperf_print_traffic_report(const iperf_report_t* report)
 {
     double transfer = 0.0;
@@ -90,32 +199,8 @@ static void iperf_print_traffic_report(const iperf_report_t* report)
         return;
     }
 
-    switch (report->traffic.output_format) {
-        case BITS_PER_SEC:
-            transfer = data_bytes;
-            break;
-        case KBITS_PER_SEC: /* '-f k' */
-            transfer = data_bytes / 1000.0;
-            format_ch = 'K';
-            break;
-        case MBITS_PER_SEC: /* '-f m' */
-            transfer = data_bytes / 1000.0 / 1000.0;
-            format_ch = 'M';
-            break;
-        case KBYTES_PER_SEC: /* '-f K' */
-            transfer = data_bytes / 1024.0;
-            format_ch = 'K';
-            is_byte = true;
-            break;
-        case MBYTES_PER_SEC: /* '-f M' */
-            transfer = data_bytes / 1024.0 / 1024.0;
-            format_ch = 'M';
-            is_byte = true;
-            break;
-        default:
-            /* should not happen */
-            break;
-    }
+    double unit_bytes = iperf_report_unit(report->traffic.output_format, &format_ch, &is_byte);
+    transfer = data_bytes / unit_bytes;
 
     if (is_byte) {
         bandwidth = transfer / (end_sec - start_sec);
@@ -123,7 +208,7 @@ static void iperf_print_traffic_report(const iperf_report_t* report)
         bandwidth = transfer / (end_sec - start_sec) * 8;
     }
 
-    printf("[%3d] %2" PRIu32 ".0-%2" PRIu32 ".0 sec\t%2.2f %cBytes\t%.2f %c%ss/sec\n",
+    printf("[%3d] %2" PRIu32 ".0-%2" PRIu32 ".0 sec\t%2.2f %cBytes\t%.2f %c%ss/sec",
         report->instance_id,
         start_sec,
         end_sec,
@@ -132,6 +217,148 @@ static void iperf_print_traffic_report(const iperf_report_t* report)
         bandwidth,
         format_ch,
         is_byte ? "Byte" : "bit");
+
+    /* UDP server: jitter, with --stats lost/total datagrams */
+    uint32_t datagrams = report->traffic.period_datagrams;
+    uint32_t lost = report->traffic.period_lost_datagrams;
+    if (report->report_type == IPERF_REPORT_SUMMARY) {
+        datagrams = report->traffic.total_datagrams;
+        lost = report->traffic.total_lost_datagrams;
+    }
+    if (datagrams != 0) {
+        /* jitter only from clients stamping their datagrams */
+        if (report->traffic.jitter_us != 0) {
+            printf("\t%.3f ms", report->traffic.jitter_us / 1000.0);
+        }
+        if (report->traffic.show_stats) {
+            printf("\t%" PRIu32 "/%" PRIu32 " (%.2g%%)", lost, datagrams + lost, 100.0 * lost / (datagrams + lost));
+        }
+    }
+    /* UDP client: sends failed for lack of buffers, offered bandwidth includes them */
+    if (report->traffic.total_failed_sends != 0) {
+        uint32_t failed_sends = report->traffic.period_failed_sends;
+        uint64_t failed_bytes = report->traffic.period_failed_bytes;
+        if (report->report_type == IPERF_REPORT_SUMMARY) {
+            failed_sends = report->traffic.total_failed_sends;
+            failed_bytes = report->traffic.total_failed_bytes;
+        }
+        double offered = (data_bytes + failed_bytes) / unit_bytes / (end_sec - start_sec) * (is_byte ? 1 : 8);
+        printf("\t%" PRIu32 " failed sends\toffered %.2f %c%ss/sec", failed_sends, offered, format_ch, is_byte ? "Byte" : "bit");
+    }
+    /* request/response: transactions, TCP connection rate: connections */
+    uint32_t transactions = report->traffic.period_transactions;
+    uint32_t connections = report->traffic.period_connections;
+    uint32_t failures = report->traffic.period_connect_failures;
+    if (report->report_type == IPERF_REPORT_SUMMARY) {
+        transactions = report->traffic.total_transactions;
+        connections = report->traffic.total_connections;
+        failures = report->traffic.total_connect_failures;
+    }
+    if (connections != 0 || failures != 0) {
+        printf("\t%" PRIu32 " conn\t%.1f conn/sec\t%" PRIu32 " failed", connections, (double)connections / (end_sec - start_sec), failures);
+    } else if (transactions != 0) {
+        printf("\t%" PRIu32 " trans\t%.1f trans/sec", transactions, (double)transactions / (end_sec - start_sec));
+    }
+    /* verify mode server: corrupted bytes and receives */
+    if (report->traffic.total_verified_bytes != 0) {
+        uint64_t corrupt_bytes = report->traffic.period_corrupt_bytes;
+        uint32_t corrupt_segments = report->traffic.period_corrupt_segments;
+        if (report->report_type == IPERF_REPORT_SUMMARY) {
+            corrupt_bytes = report->traffic.total_corrupt_bytes;
+            corrupt_segments = report->traffic.total_corrupt_segments;
+        }
+        printf("\t%" PRIu64 " corrupt bytes in %" PRIu32 " segments", corrupt_bytes, corrupt_segments);
+    }
+    printf("\n");
+
+    if (report->report_type == IPERF_REPORT_SUMMARY) {
+        const iperf_rtt_stats_t *rtt = &report->traffic.rtt;
+        if (rtt->max_us != 0 || rtt->timeouts != 0) {
+            iperf_print_rtt_stats(report->instance_id, "RTT", rtt);
+            printf("\t%" PRIu32 " timeouts\n", rtt->timeouts);
+        }
+        if (report->traffic.connect_time.max_us != 0) {
+            iperf_print_rtt_stats(report->instance_id, "Connect", &report->traffic.connect_time);
+            printf("\n");
+        }
+        if (report->traffic.start_latency_us != 0) {
+            printf("[%3d] Start latency %" PRIu32 " us\n", report->instance_id, report->traffic.start_latency_us);
+        }
+        const iperf_file_stats_t *file = &report->traffic.file_stats;
+        if (file->read_bytes != 0) {
+            printf("[%3d] File %.2f MBytes read\twaited %.1f ms for file, %.1f ms in send: %s bound\n",
+                report->instance_id,
+                file->read_bytes / 1024.0 / 1024.0,
+                file->file_wait_us / 1000.0,
+                file->send_us / 1000.0,
+                file->file_wait_us > file->send_us ? "file" : "network");
+        } else if (file->write_bytes != 0) {
+            printf("[%3d] File %.2f MBytes written\twaited %.1f ms for writes, %.1f ms in recv: %s bound\n",
+                report->instance_id,
+                file->write_bytes / 1024.0 / 1024.0,
+                file->file_wait_us / 1000.0,
+                file->recv_us / 1000.0,
+                file->file_wait_us > file->recv_us ? "write" : "network");
+        }
+        const iperf_isoch_stats_t *isoch = &report->traffic.isoch;
+        if (isoch->is_sent) {
+            printf("[%3d] Frames %" PRIu32 " sent\t%" PRIu32 " behind schedule\n", report->instance_id, isoch->frames, isoch->slipped_frames);
+        } else if (isoch->frames != 0 || isoch->incomplete_frames != 0) {
+            printf("[%3d] Frames %" PRIu32 " complete\t%" PRIu32 " incomplete\t%" PRIu32 " late\n", report->instance_id,
+                isoch->frames, isoch->incomplete_frames, isoch->late_frames);
+            if (isoch->latency.max_us != 0) {
+                iperf_print_rtt_stats(report->instance_id, "Frame latency", &isoch->latency);
+                printf("\n");
+            }
+        }
+        const iperf_trace_stats_t *trace = &report->traffic.trace;
+        if (trace->datagrams != 0) {
+            printf("[%3d] Replayed %" PRIu32 " datagrams\t%" PRIu32 " loops\n", report->instance_id, trace->datagrams, trace->loops);
+            if (trace->timing_error.max_us != 0) {
+                iperf_print_rtt_stats(report->instance_id, "Replay timing error", &trace->timing_error);
+                printf("\n");
+            }
+        }
+        if (report->traffic.backoff_us != 0) {
+            printf("[%3d] Backoff %.1f ms after %" PRIu32 " failed sends\n", report->instance_id,
+                report->traffic.backoff_us / 1000.0, report->traffic.total_failed_sends);
+        }
+        const iperf_load_stats_t *load = &report->traffic.load;
+        if (load->busy_wall_us != 0) {
+            double busy_sec = load->busy_wall_us / 1000.0 / 1000.0;
+            printf("[%3d] Load %" PRIu8 "%% CPU\tbusy %.3f sec wall clock", report->instance_id, load->duty_percent, busy_sec);
+            if (load->mem_bytes != 0) {
+                printf("\t%.2f MBytes/sec copied", load->mem_bytes / 1024.0 / 1024.0 / busy_sec);
+            }
+            printf("\n");
+        }
+    }
+
+    if (report->report_type == IPERF_REPORT_SUMMARY && report->traffic.show_stats && report->traffic.cpu_time_us != 0 && data_bytes != 0) {
+        double cpu_sec = report->traffic.cpu_time_us / 1000.0 / 1000.0;
+        printf("[%3d] CPU time %.3f sec\t%.3f sec/GByte\n",
+            report->instance_id,
+            cpu_sec,
+            cpu_sec / (data_bytes / 1024.0 / 1024.0 / 1024.0));
+    }
+
+    if (report->report_type == IPERF_REPORT_SUMMARY && report->traffic.show_stats) {
+        const iperf_transport_stats_t *stats = &report->traffic.transport_stats;
+        uint64_t calls = stats->send_calls + stats->recv_calls;
+        if (calls != 0) {
+            printf("[%3d] %" PRIu64 " calls\t%.0f Bytes/call\t%" PRIu64 " errors\t%" PRIu64 " drops",
+                report->instance_id,
+                calls,
+                (double)data_bytes / calls,
+                stats->errors,
+                stats->drops);
+            if (report->traffic.cpu_time_us != 0) {
+                // per call cost of the traffic loop, includes the transport
+                printf("\t%.0f ns/call", report->traffic.cpu_time_us * 1000.0 / calls);
+            }
+            printf("\n");
+        }
+    }
 }
 
 void iperf_default_report_output(const iperf_report_t* report)
@@ -141,6 +368,21 @@ void iperf_default_report_output(const iperf_report_t* report)
         iperf_print_connect_info(report);
         iperf_print_traffic_header();
         break;
+    case IPERF_REPORT_STEP:
+        if (report->traffic.is_load_step) {
+            printf("[%3d] Load step %" PRIu32 " at %" PRIu8 "%% CPU:\n", report->instance_id, report->traffic.step,
+                   report->traffic.step_load_percent);
+        } else {
+            char format_ch = '\0';
+            bool is_byte = false;
+            double unit_bytes = iperf_report_unit(report->traffic.output_format, &format_ch, &is_byte);
+            // the bandwidth limit is in bits/sec
+            double step_bw = report->traffic.step_bw_lim / unit_bytes / (is_byte ? 8 : 1);
+            printf("[%3d] Step %" PRIu32 " at %.2f %c%ss/sec:\n", report->instance_id, report->traffic.step,
+                   step_bw, format_ch, is_byte ? "Byte" : "bit");
+        }
+        iperf_print_traffic_report(report);
+        break;
     case IPERF_REPORT_PERIOD:
         /* fallthrough */
     case IPERF_REPORT_SUMMARY:
@@ -151,9 +393,92 @@ void iperf_default_report_output(const iperf_report_t* report)
     }
 }
 
-void iperf_report_task(void *arg)
+static void iperf_report_summary(iperf_instance_data_t *iperf_instance, iperf_report_t *report)
+{
+    iperf_instance->traffic.cpu_time_us = iperf_instance->cpu_time_us;
+    iperf_instance->traffic.transport_stats = iperf_instance->transport_stats;
+    iperf_instance->traffic.rtt = iperf_instance->rtt;
+    iperf_instance->traffic.connect_time = iperf_instance->connect_time;
+    iperf_instance->traffic.start_latency_us = iperf_instance->start_latency_us;
+    iperf_instance->traffic.file_stats = iperf_instance->file_stats;
+    iperf_instance->traffic.isoch = iperf_instance->isoch.stats;
+    iperf_instance->traffic.trace = iperf_instance->trace.stats;
+    iperf_instance->traffic.load = iperf_instance->load.stats;
+    iperf_instance->traffic.sndbuf_len = iperf_instance->socket_info.sndbuf_applied;
+    iperf_instance->traffic.rcvbuf_len = iperf_instance->socket_info.rcvbuf_applied;
+    iperf_instance->traffic.backoff_us = atomic_load(&iperf_instance->backoff.wait_us);
+    iperf_update_udp_rx_report(iperf_instance);
+    iperf_update_rr_report(iperf_instance);
+    iperf_update_verify_report(iperf_instance);
+    iperf_update_backoff_report(iperf_instance);
+
+    if (iperf_instance->traffic.end_sec != 0) {
+        iperf_copy_report(IPERF_REPORT_SUMMARY, iperf_instance, report);
+        iperf_report_output(report);
+    }
+}
+
+/* bandwidth ramp: report the finished step and continue with the next one, unless the run ended */
+static void iperf_report_ramp_step(iperf_instance_data_t *iperf_instance, iperf_report_t *report, bool is_last)
+{
+    iperf_ramp_t *ramp = &iperf_instance->ramp;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+
+    if (traffic->end_sec <= ramp->step_start_sec) {
+        return;
+    }
+    iperf_copy_report(IPERF_REPORT_STEP, iperf_instance, report);
+    report->traffic.period_start_sec = ramp->step_start_sec;
+    report->traffic.period_bytes = traffic->total_transfer_bytes - ramp->step_start_bytes;
+    report->traffic.step = ramp->step;
+    report->traffic.step_bw_lim = iperf_instance->bw_lim;
+    iperf_report_output(report);
+
+    ramp->step_start_sec = traffic->end_sec;
+    ramp->step_start_bytes = traffic->total_transfer_bytes;
+    ramp->step++;
+    if (is_last) {
+        return;
+    }
+    int64_t bw_lim = (int64_t)iperf_instance->bw_lim + ramp->cfg.step_bw;
+    if (ramp->cfg.max_bw > 0) {
+        bw_lim = MIN(bw_lim, ramp->cfg.max_bw);
+    }
+    bw_lim = MIN(bw_lim, INT32_MAX);
+    if (bw_lim != iperf_instance->bw_lim) {
+        iperf_set_tx_bandwidth(iperf_instance, bw_lim);
+    }
+}
+
+/* load steps: report the finished load level and raise it, unless the run ended */
+static void iperf_report_load_step(iperf_instance_data_t *iperf_instance, iperf_report_t *report, bool is_last)
+{
+    iperf_load_t *load = &iperf_instance->load;
+    iperf_traffic_report_t *traffic = &iperf_instance->traffic;
+
+    if (traffic->end_sec <= load->step_start_sec) {
+        return;
+    }
+    uint8_t duty_percent = atomic_load(&load->duty_percent);
+    iperf_copy_report(IPERF_REPORT_STEP, iperf_instance, report);
+    report->traffic.period_start_sec = load->step_start_sec;
+    report->traffic.period_bytes = traffic->total_transfer_bytes - load->step_start_bytes;
+    report->traffic.step = load->step;
+    report->traffic.is_load_step = true;
+    report->traffic.step_load_percent = duty_percent;
+    iperf_report_output(report);
+
+    load->step_start_sec = traffic->end_sec;
+    load->step_start_bytes = traffic->total_transfer_bytes;
+    load->step++;
+    if (!is_last) {
+        atomic_store(&load->duty_percent, MIN(duty_percent + load->cfg.step_percent, 100));
+    }
+}
+
+/* reports of one run */
+static void iperf_report_run(iperf_instance_data_t *iperf_instance)
 {
-    iperf_instance_data_t *iperf_instance = (iperf_instance_data_t *) arg;
     uint32_t data_len; /* period_data_snapshot is uint32_t */
     bool connnect_info_printed = false;
     iperf_report_t report;
@@ -176,17 +501,76 @@ void iperf_report_task(void *arg)
             iperf_instance->traffic.total_transfer_bytes += data_len;
             iperf_instance->traffic.period_start_sec = iperf_instance->traffic.end_sec;
             iperf_instance->traffic.end_sec += report_task_data_tmp.period_sec;
+            iperf_update_udp_rx_report(iperf_instance);
+            iperf_update_rr_report(iperf_instance);
+            iperf_update_verify_report(iperf_instance);
+            iperf_update_backoff_report(iperf_instance);
             /* IPERF_RUNNING to the state handler */
             iperf_state_action(IPERF_RUNNING, iperf_instance);
             iperf_copy_report(IPERF_REPORT_PERIOD, iperf_instance, &report);
             iperf_report_output(&report);
+            if (iperf_instance->ramp.cfg.step_sec != 0 &&
+                    iperf_instance->traffic.end_sec - iperf_instance->ramp.step_start_sec >= iperf_instance->ramp.cfg.step_sec) {
+                iperf_report_ramp_step(iperf_instance, &report, false);
+            }
+            if (iperf_instance->load.cfg.step_sec != 0 &&
+                    iperf_instance->traffic.end_sec - iperf_instance->load.step_start_sec >= iperf_instance->load.cfg.step_sec) {
+                iperf_report_load_step(iperf_instance, &report, false);
+            }
+        }
+        if (atomic_load(&iperf_instance->session_end)) {
+            // daemon server: summary of the finished client, the next client starts a new report
+            iperf_report_summary(iperf_instance, &report);
+            iperf_output_format_t output_format = iperf_instance->traffic.output_format;
+            memset(&iperf_instance->traffic, 0, sizeof(iperf_traffic_report_t));
+            iperf_instance->traffic.output_format = output_format;
+            connnect_info_printed = false;
+            atomic_store(&iperf_instance->session_end, false);
+            xTaskNotifyGive(iperf_instance->traffic_task_hdl);
         }
     } while (iperf_instance->is_running);
 
-    if (iperf_instance->traffic.end_sec != 0) {
-        iperf_copy_report(IPERF_REPORT_SUMMARY, iperf_instance, &report);
-        iperf_report_output(&report);
+    // wait for the traffic loop to finish so its CPU time is accounted in the summary, the traffic task notifies
+    TickType_t wait_start = xTaskGetTickCount();
+    while (!atomic_load(&iperf_instance->traffic_finished) &&
+            xTaskGetTickCount() - wait_start < pdMS_TO_TICKS(IPERF_REPORT_WAIT_TRAFFIC_TMO_MS)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IPERF_REPORT_WAIT_TRAFFIC_TMO_MS));
     }
+    if (iperf_instance->ramp.cfg.step_sec != 0) {
+        // the test may end within a step
+        iperf_report_ramp_step(iperf_instance, &report, true);
+    }
+    if (iperf_instance->load.cfg.step_sec != 0) {
+        iperf_report_load_step(iperf_instance, &report, true);
+    }
+    iperf_report_summary(iperf_instance, &report);
+}
+
+/* warm instance: wait until the traffic task starts the next run, false when the instance is to be deleted */
+static bool iperf_report_park(iperf_instance_data_t *iperf_instance)
+{
+    if (!(iperf_instance->flags & IPERF_FLAG_WARM)) {
+        return false;
+    }
+    atomic_store(&iperf_instance->report_parked, true);
+    xTaskNotifyGive(iperf_instance->traffic_task_hdl);
+    while (atomic_load(&iperf_instance->report_parked) && !atomic_load(&iperf_instance->release)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    if (atomic_load(&iperf_instance->release)) {
+        atomic_store(&iperf_instance->report_parked, false);
+        return false;
+    }
+    return true;
+}
+
+void iperf_report_task(void *arg)
+{
+    iperf_instance_data_t *iperf_instance = (iperf_instance_data_t *) arg;
+
+    do {
+        iperf_report_run(iperf_instance);
+    } while (iperf_report_park(iperf_instance));
 
     ESP_LOGD(TAG, "report (id=%d) task exited", iperf_instance->id);
     iperf_instance->report_task_hdl = NULL;
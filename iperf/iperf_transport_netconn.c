@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * lwIP netconn transport.
+ *
+ * Bypasses the socket layer and its copies where lwIP allows it:
+ * - UDP client: datagrams reference the instance buffer (PBUF_REF) instead of being copied into a new pbuf
+ * - servers: received pbufs are counted and freed, only the UDP datagram headers are copied out
+ * TCP client data is still copied, lwIP keeps unacknowledged data referenced beyond the lifetime of the instance buffer.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "iperf.h"
+#include "iperf_private.h"
+
+#if IPERF_NETCONN_SUPPORTED
+#include "lwip/api.h"
+#include "lwip/ip.h"
+#include "lwip/tcpip.h"
+
+#define IPERF_NETCONN_POLL_MS       (100)
+
+#define TAG_ID iperf_instance->tag
+
+typedef struct {
+    struct netconn *conn;
+    struct netconn *listen_conn;  /* TCP server */
+    struct netbuf *tx_buf;  /* UDP client: references the instance buffer */
+} iperf_netconn_t;
+
+static void iperf_netconn_addr(const esp_ip_addr_t *src, ip_addr_t *dst)
+{
+#if IPERF_IPV6_ENABLED
+    if (src->type == ESP_IPADDR_TYPE_V6) {
+        IP_ADDR6(dst, src->u_addr.ip6.addr[0], src->u_addr.ip6.addr[1], src->u_addr.ip6.addr[2], src->u_addr.ip6.addr[3]);
+        return;
+    }
+#endif
+#if IPERF_IPV4_ENABLED
+    ip_addr_set_ip4_u32(dst, src->u_addr.ip4.addr);
+#endif
+}
+
+static bool iperf_netconn_addr_is_any(const esp_ip_addr_t *addr)
+{
+#if IPERF_IPV6_ENABLED
+    if (addr->type == ESP_IPADDR_TYPE_V6) {
+        return !(addr->u_addr.ip6.addr[0] | addr->u_addr.ip6.addr[1] | addr->u_addr.ip6.addr[2] | addr->u_addr.ip6.addr[3]);
+    }
+#endif
+    return addr->u_addr.ip4.addr == 0;
+}
+
+typedef struct {
+    struct netconn *conn;
+    uint8_t tos;
+    SemaphoreHandle_t done;
+} iperf_netconn_tos_t;
+
+/* runs in the tcpip thread, which owns the pcb */
+static void iperf_netconn_set_tos_cb(void *ctx)
+{
+    iperf_netconn_tos_t *req = ctx;
+
+    req->conn->pcb.ip->tos = req->tos;
+    xSemaphoreGive(req->done);
+}
+
+/* netconn has no TOS call, the pcb field is set from the tcpip thread */
+static void iperf_netconn_set_tos(iperf_instance_data_t *iperf_instance, struct netconn *conn)
+{
+    StaticSemaphore_t done_buffer;
+    iperf_netconn_tos_t req = {
+        .conn = conn,
+        .tos = iperf_instance->socket_info.tos,
+    };
+
+    if (req.tos == 0) {
+        return;
+    }
+    req.done = xSemaphoreCreateBinaryStatic(&done_buffer);
+    if (tcpip_callback(iperf_netconn_set_tos_cb, &req) != ERR_OK) {
+        ESP_LOGW(TAG_ID, "failed to set TOS");
+        return;
+    }
+    xSemaphoreTake(req.done, portMAX_DELAY);
+}
+
+static void iperf_netconn_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_netconn_t *nc = iperf_instance->transport_priv;
+
+    if (nc == NULL) {
+        return;
+    }
+    if (nc->tx_buf) {
+        netbuf_delete(nc->tx_buf);
+    }
+    if (nc->conn) {
+        netconn_delete(nc->conn);
+    }
+    if (nc->listen_conn) {
+        netconn_delete(nc->listen_conn);
+    }
+    free(nc);
+    iperf_instance->transport_priv = NULL;
+    ESP_LOGD(TAG_ID, "netconn is closed");
+}
+
+static esp_err_t iperf_netconn_open(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    bool is_server = iperf_instance->flags & IPERF_FLAG_SERVER;
+    const esp_ip_addr_t *local = &iperf_instance->socket_info.source;
+    const esp_ip_addr_t *remote = &iperf_instance->socket_info.destination;
+    bool is_v6 = (is_server ? local->type : remote->type) == ESP_IPADDR_TYPE_V6;
+    enum netconn_type type = is_udp ? NETCONN_UDP : NETCONN_TCP;
+    struct netconn *conn = NULL;
+    ip_addr_t addr;
+    err_t err;
+
+#if IPERF_IPV6_ENABLED
+    if (is_v6) {
+        type = is_udp ? NETCONN_UDP_IPV6 : NETCONN_TCP_IPV6;
+    }
+#endif
+    iperf_netconn_t *nc = calloc(1, sizeof(iperf_netconn_t));
+    ESP_RETURN_ON_FALSE(nc, ESP_ERR_NO_MEM, TAG_ID, "cannot open netconn: not enough memory");
+    iperf_instance->transport_priv = nc;
+
+    conn = netconn_new(type);
+    ESP_GOTO_ON_FALSE(conn, ESP_ERR_NO_MEM, err, TAG_ID, "cannot open netconn: not enough memory");
+    iperf_netconn_set_tos(iperf_instance, conn);
+
+    if (is_server) {
+        iperf_netconn_addr(local, &addr);
+        if (is_udp) {
+            nc->conn = conn;
+        } else {
+            nc->listen_conn = conn;
+        }
+        err = netconn_bind(conn, &addr, iperf_instance->socket_info.sport);
+        ESP_GOTO_ON_FALSE(err == ERR_OK, ESP_FAIL, err, TAG_ID, "cannot start server: netconn is unable to bind - err %d", err);
+        if (!is_udp) {
+            err = netconn_listen(conn);
+            ESP_GOTO_ON_FALSE(err == ERR_OK, ESP_FAIL, err, TAG_ID, "cannot start TCP server: an error occurred during listen - err %d", err);
+            ESP_LOGI(TAG_ID, "[TCP Server] Netconn created");
+            netconn_set_recvtimeout(conn, IPERF_SOCKET_ACCEPT_TIMEOUT * 1000);
+            err = netconn_accept(conn, &nc->conn);
+            ESP_GOTO_ON_FALSE(err == ERR_OK, ESP_FAIL, err, TAG_ID, "cannot start TCP server: netconn is unable to accept connection - err %d", err);
+        } else {
+            ESP_LOGI(TAG_ID, "[UDP Server] Netconn created");
+        }
+        // blocking receive is split so that a stopped instance is noticed without an abort call
+        netconn_set_recvtimeout(nc->conn, IPERF_NETCONN_POLL_MS);
+    } else {
+        nc->conn = conn;
+        if (!iperf_netconn_addr_is_any(local) || iperf_instance->socket_info.sport) {
+            iperf_netconn_addr(local, &addr);
+            err = netconn_bind(conn, &addr, iperf_instance->socket_info.sport);
+            ESP_GOTO_ON_FALSE(err == ERR_OK, ESP_FAIL, err, TAG_ID, "cannot start client: netconn is unable to bind - err %d", err);
+        }
+        iperf_netconn_addr(remote, &addr);
+        err = netconn_connect(conn, &addr, iperf_instance->socket_info.dport);
+        ESP_GOTO_ON_FALSE(err == ERR_OK, ESP_FAIL, err, TAG_ID, "cannot start client: netconn is unable to connect - err %d", err);
+        if (is_udp) {
+            nc->tx_buf = netbuf_new();
+            ESP_GOTO_ON_FALSE(nc->tx_buf, ESP_ERR_NO_MEM, err, TAG_ID, "cannot start UDP client: not enough memory");
+        } else {
+            netconn_set_sendtimeout(conn, IPERF_SOCKET_TCP_TX_TIMEOUT * 1000);
+        }
+        ESP_LOGD(TAG_ID, "[%s Client] Netconn connected", is_udp ? "UDP" : "TCP");
+    }
+    // connect info is reported from the destination/source address
+    iperf_instance->socket_info.target_addr.ss_family = is_v6 ? AF_INET6 : AF_INET;
+    return ESP_OK;
+err:
+    iperf_netconn_close(iperf_instance);
+    return ret;
+}
+
+IRAM_ATTR static int iperf_netconn_send(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, size_t len)
+{
+    iperf_netconn_t *nc = iperf_instance->transport_priv;
+    err_t err;
+
+    if (nc->tx_buf) {
+        // reference the buffer, the datagram is not copied before it reaches the netif
+        err = netbuf_ref(nc->tx_buf, buffer, len);
+        if (err == ERR_OK) {
+            err = netconn_send(nc->conn, nc->tx_buf);
+        }
+        if (err != ERR_OK) {
+            errno = err_to_errno(err);
+            return -1;
+        }
+        return len;
+    }
+    size_t written = 0;
+    err = netconn_write_partly(nc->conn, buffer, len, NETCONN_COPY, &written);
+    if (err != ERR_OK && written == 0) {
+        errno = err_to_errno(err);
+        return -1;
+    }
+    return written;
+}
+
+IRAM_ATTR static int iperf_netconn_recv(iperf_instance_data_t *iperf_instance, uint8_t *buffer, size_t len)
+{
+    iperf_netconn_t *nc = iperf_instance->transport_priv;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    uint32_t waited_ms = 0;
+    err_t err;
+
+    while (iperf_instance->is_running) {
+        if (is_udp) {
+            struct netbuf *nb = NULL;
+            err = netconn_recv(nc->conn, &nb);
+            if (err == ERR_OK) {
+                int recv_len = netbuf_len(nb);
+                // only the sequence number and the frame of isochronous datagrams are needed for accounting
+                netbuf_copy_partial(nb, buffer, MIN(len, MIN(recv_len, IPERF_ISOCH_HDR_LEN)), 0);
+                netbuf_delete(nb);
+                return recv_len;
+            }
+        } else {
+            struct pbuf *p = NULL;
+            err = netconn_recv_tcp_pbuf(nc->conn, &p);
+            if (err == ERR_OK) {
+                int recv_len = p->tot_len;
+                pbuf_free(p);
+                return recv_len;
+            }
+            if (err == ERR_CLSD) {
+                // end of stream
+                return 0;
+            }
+        }
+        if (err != ERR_TIMEOUT) {
+            errno = err_to_errno(err);
+            return -1;
+        }
+        waited_ms += IPERF_NETCONN_POLL_MS;
+        if (waited_ms >= IPERF_SOCKET_RX_TIMEOUT * 1000) {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+    errno = EBADF;
+    return -1;
+}
+
+const iperf_transport_t iperf_transport_netconn = {
+    .name = "netconn",
+    .open = iperf_netconn_open,
+    .send = iperf_netconn_send,
+    .recv = iperf_netconn_recv,
+    .close = iperf_netconn_close,
+};
+
+#endif // IPERF_NETCONN_SUPPORTED
@@ -176,6 +176,26 @@ __attribute__((weak)) esp_err_t esp_timer_start_periodic(esp_timer_handle_t time
 
 }
 
+__attribute__((weak)) esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == NULL) {
+        printf("Invalid Handler!\n");
+        return ESP_FAIL;
+    }
+    struct itimerspec its = {0};
+    its.it_value.tv_sec = timeout_us / 1000000;
+    its.it_value.tv_nsec = (timeout_us % 1000000) * 1000;
+    if (timeout_us == 0) {
+        /* a zero it_value disarms the timer, expire as soon as possible instead */
+        its.it_value.tv_nsec = 1;
+    }
+    if (timer_settime(timer->timerid, 0, &its, NULL) == -1) {
+        printf("timer_settime failed\n");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 __attribute__((weak)) esp_err_t esp_timer_stop(esp_timer_handle_t timer)
 {
     if (timer == NULL) {
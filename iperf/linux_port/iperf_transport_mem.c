@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * In-memory transport for the linux target.
+ *
+ * A server opens an endpoint identified by protocol and port, clients sending to that port write into the endpoint
+ * buffer. No network stack is involved, so the measured rate reflects the per packet cost of the iperf engine itself
+ * (loops, accounting, pacing and reporting) plus one memory copy per direction.
+ * UDP endpoints keep datagram boundaries and drop datagrams when full, TCP endpoints are byte streams which block the
+ * sender when full and accept one client at a time. A daemon server accepts the next client once the previous one has
+ * closed and its data is drained, so that the streams of successive clients are not mixed.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/queue.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/message_buffer.h"
+#include "esp_log.h"
+#include "iperf.h"
+#include "iperf_private.h"
+
+#if IPERF_MEMORY_TRANSPORT_SUPPORTED
+
+#define IPERF_MEM_BUFFER_SIZE       (256 * 1024)
+#define IPERF_MEM_POLL_MS           (100)
+
+#define TAG_ID iperf_instance->tag
+
+typedef struct iperf_mem_endpoint {
+    LIST_ENTRY(iperf_mem_endpoint) _list_entry;
+    uint16_t port;
+    bool is_udp;
+    StreamBufferHandle_t buffer;  /* message buffer for UDP */
+    uint32_t max_datagram_len;  /* UDP: receive length of the server, longer datagrams are truncated */
+    SemaphoreHandle_t send_lock;  /* stream and message buffers allow one writer at a time */
+    uint32_t refcnt;  /* server and clients referencing the endpoint */
+    bool has_client;  /* TCP: a client is connected, released when the server accepts the next one */
+    SemaphoreHandle_t accept_sem;  /* TCP: given when a client connects */
+    _Atomic bool server_closed;
+    _Atomic bool client_closed;
+    _Atomic uint64_t drops;
+} iperf_mem_endpoint_t;
+
+static LIST_HEAD(iperf_mem_endpoints, iperf_mem_endpoint) s_endpoints = LIST_HEAD_INITIALIZER(s_endpoints);
+static StaticSemaphore_t s_endpoints_lock_buffer;
+static SemaphoreHandle_t s_endpoints_lock = NULL;
+
+/* the endpoints lock must be held */
+static iperf_mem_endpoint_t *iperf_mem_find_endpoint(uint16_t port, bool is_udp)
+{
+    iperf_mem_endpoint_t *endpoint;
+    LIST_FOREACH(endpoint, &s_endpoints, _list_entry) {
+        if (endpoint->port == port && endpoint->is_udp == is_udp && !atomic_load(&endpoint->server_closed)) {
+            return endpoint;
+        }
+    }
+    return NULL;
+}
+
+/* the endpoints lock must be held */
+static void iperf_mem_release_endpoint(iperf_mem_endpoint_t *endpoint)
+{
+    if (--endpoint->refcnt == 0) {
+        LIST_REMOVE(endpoint, _list_entry);
+        vStreamBufferDelete(endpoint->buffer);
+        vSemaphoreDelete(endpoint->send_lock);
+        if (endpoint->accept_sem) {
+            vSemaphoreDelete(endpoint->accept_sem);
+        }
+        free(endpoint);
+    }
+}
+
+/* UDP clients may be started before the server, they look the endpoint up until it exists */
+static iperf_mem_endpoint_t *iperf_mem_connect(iperf_instance_data_t *iperf_instance)
+{
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    iperf_mem_endpoint_t *endpoint;
+
+    xSemaphoreTake(s_endpoints_lock, portMAX_DELAY);
+    endpoint = iperf_mem_find_endpoint(iperf_instance->socket_info.dport, is_udp);
+    if (endpoint != NULL && !is_udp) {
+        if (endpoint->has_client) {
+            endpoint = NULL;
+        } else {
+            endpoint->has_client = true;
+            xSemaphoreGive(endpoint->accept_sem);
+        }
+    }
+    if (endpoint != NULL) {
+        endpoint->refcnt++;
+    }
+    xSemaphoreGive(s_endpoints_lock);
+    iperf_instance->transport_priv = endpoint;
+    return endpoint;
+}
+
+static esp_err_t iperf_mem_open(iperf_instance_data_t *iperf_instance)
+{
+    esp_err_t ret = ESP_OK;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+    iperf_mem_endpoint_t *endpoint = NULL;
+
+    if (s_endpoints_lock == NULL) {
+        s_endpoints_lock = xSemaphoreCreateMutexStatic(&s_endpoints_lock_buffer);
+        ESP_RETURN_ON_FALSE(s_endpoints_lock, ESP_FAIL, TAG_ID, "failed to create static mutex");
+    }
+    // connect info is reported from the destination/source address
+    iperf_instance->socket_info.target_addr.ss_family = (iperf_instance->socket_info.destination.type == ESP_IPADDR_TYPE_V6) ? AF_INET6 : AF_INET;
+
+    if (iperf_instance->flags & IPERF_FLAG_CLIENT) {
+        if (iperf_mem_connect(iperf_instance) == NULL && !is_udp) {
+            ESP_LOGE(TAG_ID, "cannot start TCP client: no memory server on port %" PRIu16 " - errno %d", iperf_instance->socket_info.dport, ECONNREFUSED);
+            return ESP_FAIL;
+        }
+        ESP_LOGD(TAG_ID, "[%s Client] memory endpoint, sending to port %" PRIu16, is_udp ? "UDP" : "TCP", iperf_instance->socket_info.dport);
+        return ESP_OK;
+    }
+
+    endpoint = calloc(1, sizeof(iperf_mem_endpoint_t));
+    ESP_RETURN_ON_FALSE(endpoint, ESP_ERR_NO_MEM, TAG_ID, "cannot start memory server: not enough memory");
+    endpoint->port = iperf_instance->socket_info.sport;
+    endpoint->is_udp = is_udp;
+    endpoint->max_datagram_len = iperf_instance->socket_info.buffer_len;
+    endpoint->refcnt = 1;
+    endpoint->buffer = is_udp ? xMessageBufferCreate(IPERF_MEM_BUFFER_SIZE) : xStreamBufferCreate(IPERF_MEM_BUFFER_SIZE, 1);
+    endpoint->send_lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(endpoint->buffer && endpoint->send_lock, ESP_ERR_NO_MEM, err, TAG_ID, "cannot start memory server: not enough memory");
+    if (!is_udp) {
+        endpoint->accept_sem = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(endpoint->accept_sem, ESP_ERR_NO_MEM, err, TAG_ID, "cannot start memory server: not enough memory");
+    }
+
+    xSemaphoreTake(s_endpoints_lock, portMAX_DELAY);
+    if (iperf_mem_find_endpoint(endpoint->port, is_udp) != NULL) {
+        xSemaphoreGive(s_endpoints_lock);
+        ESP_GOTO_ON_FALSE(false, ESP_FAIL, err, TAG_ID, "cannot start memory server: port %" PRIu16 " is in use - errno %d", endpoint->port, EADDRINUSE);
+    }
+    LIST_INSERT_HEAD(&s_endpoints, endpoint, _list_entry);
+    xSemaphoreGive(s_endpoints_lock);
+    iperf_instance->transport_priv = endpoint;
+    ESP_LOGI(TAG_ID, "[%s Server] Memory endpoint created", is_udp ? "UDP" : "TCP");
+    return ESP_OK;
+err:
+    if (endpoint->buffer) {
+        vStreamBufferDelete(endpoint->buffer);
+    }
+    if (endpoint->send_lock) {
+        vSemaphoreDelete(endpoint->send_lock);
+    }
+    if (endpoint->accept_sem) {
+        vSemaphoreDelete(endpoint->accept_sem);
+    }
+    free(endpoint);
+    return ret;
+}
+
+static int iperf_mem_send(iperf_instance_data_t *iperf_instance, const uint8_t *buffer, size_t len)
+{
+    iperf_mem_endpoint_t *endpoint = iperf_instance->transport_priv;
+    bool is_udp = iperf_instance->flags & IPERF_FLAG_UDP;
+
+    if (endpoint == NULL) {
+        // UDP without server yet, the datagram is lost like on a network
+        if (iperf_mem_connect(iperf_instance) == NULL) {
+            return len;
+        }
+        endpoint = iperf_instance->transport_priv;
+    }
+    if (atomic_load(&endpoint->server_closed)) {
+        if (is_udp) {
+            return len;
+        }
+        errno = EPIPE;
+        return -1;
+    }
+
+    xSemaphoreTake(endpoint->send_lock, portMAX_DELAY);
+    if (is_udp) {
+        // datagrams longer than the server receive length are truncated, as the socket layer would do
+        if (xMessageBufferSend(endpoint->buffer, buffer, MIN(len, endpoint->max_datagram_len), 0) == 0) {
+            atomic_fetch_add(&endpoint->drops, 1);
+        }
+        xSemaphoreGive(endpoint->send_lock);
+        return len;
+    }
+    size_t sent = 0;
+    uint32_t waited_ms = 0;
+    while (sent < len && iperf_instance->is_running && !atomic_load(&endpoint->server_closed)) {
+        size_t n = xStreamBufferSend(endpoint->buffer, buffer + sent, len - sent, pdMS_TO_TICKS(IPERF_MEM_POLL_MS));
+        if (n == 0) {
+            waited_ms += IPERF_MEM_POLL_MS;
+            if (waited_ms >= IPERF_SOCKET_TCP_TX_TIMEOUT * 1000) {
+                break;
+            }
+        }
+        sent += n;
+    }
+    xSemaphoreGive(endpoint->send_lock);
+    if (sent == 0 && len != 0) {
+        errno = atomic_load(&endpoint->server_closed) ? EPIPE : EAGAIN;
+        return -1;
+    }
+    return sent;
+}
+
+static int iperf_mem_recv(iperf_instance_data_t *iperf_instance, uint8_t *buffer, size_t len)
+{
+    iperf_mem_endpoint_t *endpoint = iperf_instance->transport_priv;
+    uint32_t waited_ms = 0;
+
+    // blocking receive is split so that a stopped instance is noticed without an abort call
+    while (iperf_instance->is_running && !atomic_load(&endpoint->server_closed)) {
+        size_t n = xStreamBufferReceive(endpoint->buffer, buffer, len, pdMS_TO_TICKS(IPERF_MEM_POLL_MS));
+        if (n > 0) {
+            return n;
+        }
+        if (!endpoint->is_udp && atomic_load(&endpoint->client_closed)) {
+            // end of stream
+            return 0;
+        }
+        waited_ms += IPERF_MEM_POLL_MS;
+        if (waited_ms >= IPERF_SOCKET_RX_TIMEOUT * 1000) {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+    errno = EBADF;
+    return -1;
+}
+
+static void iperf_mem_close(iperf_instance_data_t *iperf_instance)
+{
+    iperf_mem_endpoint_t *endpoint = iperf_instance->transport_priv;
+
+    if (endpoint == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_endpoints_lock, portMAX_DELAY);
+    if (iperf_instance->flags & IPERF_FLAG_SERVER) {
+        atomic_store(&endpoint->server_closed, true);
+    } else if (!endpoint->is_udp) {
+        atomic_store(&endpoint->client_closed, true);
+    }
+    iperf_mem_release_endpoint(endpoint);
+    xSemaphoreGive(s_endpoints_lock);
+    iperf_instance->transport_priv = NULL;
+    ESP_LOGD(TAG_ID, "memory endpoint is closed");
+}
+
+/*
+ * Daemon TCP server: accept the next client. A closed client is released here rather than in its close, its stream
+ * ended when recv returned 0, so the buffer is empty and the next client starts a stream of its own. A client which is
+ * still connected, e.g. after a receive timeout, is served on.
+ */
+static esp_err_t iperf_mem_reconnect(iperf_instance_data_t *iperf_instance)
+{
+    iperf_mem_endpoint_t *endpoint = iperf_instance->transport_priv;
+
+    if ((iperf_instance->flags & IPERF_FLAG_CLIENT) || endpoint->is_udp) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    xSemaphoreTake(s_endpoints_lock, portMAX_DELAY);
+    if (endpoint->has_client && !atomic_load(&endpoint->client_closed)) {
+        xSemaphoreTake(endpoint->accept_sem, 0);
+        xSemaphoreGive(s_endpoints_lock);
+        return ESP_OK;
+    }
+    if (atomic_load(&endpoint->client_closed)) {
+        xStreamBufferReset(endpoint->buffer);
+        atomic_store(&endpoint->client_closed, false);
+        endpoint->has_client = false;
+    }
+    xSemaphoreGive(s_endpoints_lock);
+    // split like a blocking receive, so that a stopped instance is noticed
+    while (iperf_instance->is_running) {
+        if (xSemaphoreTake(endpoint->accept_sem, pdMS_TO_TICKS(IPERF_MEM_POLL_MS)) == pdTRUE) {
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+static void iperf_mem_get_stats(iperf_instance_data_t *iperf_instance, iperf_transport_stats_t *stats)
+{
+    iperf_mem_endpoint_t *endpoint = iperf_instance->transport_priv;
+
+    // drops are reported by the receiving side, where they show up as lost datagrams
+    if (endpoint != NULL && (iperf_instance->flags & IPERF_FLAG_SERVER)) {
+        stats->drops = atomic_load(&endpoint->drops);
+    }
+}
+
+const iperf_transport_t iperf_transport_memory = {
+    .name = "memory",
+    .open = iperf_mem_open,
+    .send = iperf_mem_send,
+    .recv = iperf_mem_recv,
+    .close = iperf_mem_close,
+    .get_stats = iperf_mem_get_stats,
+    .reconnect = iperf_mem_reconnect,
+};
+
+#endif // IPERF_MEMORY_TRANSPORT_SUPPORTED